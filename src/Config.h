@@ -217,6 +217,12 @@ const double PARKING_PULLOUT_RATE      = 250.0;  // Pull-out/plunge slow feed ra
 const double PARKING_PULLOUT_INCREMENT = 5.0;    // Spindle pull-out and plunge distance in mm. Incremental distance.
 // Must be positive value or equal to zero.
 
+// ENABLE_TRACE records state changes, planner and segment buffer activity,
+// spindle commands and limit events in an 8KB binary ring with CPU cycle
+// timestamps.  Dump it with $Trace/Dump and convert it to a Chrome trace /
+// Perfetto timeline with tools/trace2json.py.
+// #define ENABLE_TRACE
+
 // INCLUDE_OLED_IO enables access to a basic OLED library.  To use it you must uncomment the
 //  "thingpulse/ESP8266 and ESP32 OLED driver for SSD1306 displays" line in platformio.ini
 // You must uncomment it if you use either INCLUDE_OLED_TINY or INCLUDE_OLED_BASIC
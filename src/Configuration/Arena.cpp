@@ -0,0 +1,113 @@
+// Copyright (c) 2021 -  FluidNC contributors
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#include "Arena.h"
+
+#include <cstdlib>
+#include <new>
+
+namespace Configuration {
+    Arena::Block* Arena::_head        = nullptr;
+    bool          Arena::_open        = false;
+    size_t        Arena::_allocations = 0;
+    size_t        Arena::_requested   = 0;
+
+    static inline size_t alignUp(size_t n) { return (n + Arena::alignment - 1) & ~(Arena::alignment - 1); }
+
+    static const size_t headerSize = (sizeof(void*) + 2 * sizeof(size_t) + Arena::alignment - 1) & ~(Arena::alignment - 1);
+
+    Arena::Block* Arena::newBlock(size_t minSize) {
+        size_t size  = minSize > blockSize ? minSize : blockSize;
+        auto   block = static_cast<Block*>(malloc(headerSize + size));
+        if (!block) {
+            throw std::bad_alloc();
+        }
+        block->next = _head;
+        block->size = size;
+        block->used = 0;
+        _head       = block;
+        return block;
+    }
+
+    void* Arena::allocate(size_t size) {
+        size = alignUp(size ? size : 1);
+
+        // Only the newest block is considered; leftovers in older blocks are small
+        // because a new block is only started when the current one cannot fit.
+        Block* block = _head;
+        if (!block || block->size - block->used < size) {
+            block = newBlock(size);
+        }
+        void* p = reinterpret_cast<uint8_t*>(block) + headerSize + block->used;
+        block->used += size;
+
+        ++_allocations;
+        _requested += size;
+        return p;
+    }
+
+    bool Arena::owns(const void* p) {
+        auto addr = reinterpret_cast<const uint8_t*>(p);
+        for (Block* block = _head; block; block = block->next) {
+            auto start = reinterpret_cast<const uint8_t*>(block) + headerSize;
+            if (addr >= start && addr < start + block->size) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void Arena::release() {
+        while (_head) {
+            Block* next = _head->next;
+            free(_head);
+            _head = next;
+        }
+        _allocations = 0;
+        _requested   = 0;
+    }
+
+    void* Arena::create(size_t size) {
+        if (_open) {
+            return allocate(size);
+        }
+        void* p = malloc(size ? size : 1);
+        if (!p) {
+            throw std::bad_alloc();
+        }
+        return p;
+    }
+
+    void Arena::destroy(void* p) {
+        // Arena memory is reclaimed as a unit by release()
+        if (p && !owns(p)) {
+            free(p);
+        }
+    }
+
+    size_t Arena::blocks() {
+        size_t n = 0;
+        for (Block* block = _head; block; block = block->next) {
+            ++n;
+        }
+        return n;
+    }
+
+    size_t Arena::reserved() {
+        size_t n = 0;
+        for (Block* block = _head; block; block = block->next) {
+            n += headerSize + block->size;
+        }
+        return n;
+    }
+
+    size_t Arena::used() {
+        size_t n = 0;
+        for (Block* block = _head; block; block = block->next) {
+            n += block->used;
+        }
+        return n;
+    }
+
+    size_t Arena::heapEquivalent() { return _requested + _allocations * heapOverhead; }
+}
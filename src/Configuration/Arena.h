@@ -0,0 +1,88 @@
+// Copyright (c) 2021 -  FluidNC contributors
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Configuration {
+    // The configuration tree (Configurables, pin details, speed maps) is built once
+    // during MachineConfig::load() and lives until the machine is reconfigured.  Rather
+    // than scattering hundreds of small long-lived allocations across the heap before
+    // WiFi starts, everything created while the arena is open is bump-allocated from a
+    // short chain of large blocks.  Deleting an arena object runs its destructor but does
+    // not free memory; the memory is returned all at once by release().
+    //
+    // Objects created while the arena is closed (e.g. by runtime settings) still come
+    // from the heap, so operator delete checks ownership before freeing.
+    class Arena {
+        struct Block {
+            Block* next;
+            size_t size;  // usable bytes following the header
+            size_t used;
+        };
+
+        static Block* _head;
+        static bool   _open;
+
+        // Statistics for the report
+        static size_t _allocations;
+        static size_t _requested;
+
+        static Block* newBlock(size_t minSize);
+
+    public:
+        static const size_t blockSize = 2048;
+        static const size_t alignment = 8;
+
+        // Approximate per-allocation bookkeeping cost of the general-purpose heap,
+        // used to estimate what the same objects would have cost without the arena.
+        static const size_t heapOverhead = 8;
+
+        static void open() { _open = true; }
+        static void close() { _open = false; }
+        static bool isOpen() { return _open; }
+
+        static void* allocate(size_t size);
+        static bool  owns(const void* p);
+
+        // Frees every block.  All objects in the arena must already be destroyed.
+        static void release();
+
+        // Allocation helpers for class-level operator new/delete.  They use the arena
+        // when it is open and fall back to the heap otherwise.
+        static void* create(size_t size);
+        static void  destroy(void* p);
+
+        static size_t blocks();
+        static size_t reserved();  // bytes obtained from the heap, including headers
+        static size_t used();      // bytes handed out, including alignment padding
+        static size_t allocations() { return _allocations; }
+        static size_t requested() { return _requested; }
+        static size_t heapEquivalent();  // estimated heap footprint without the arena
+    };
+
+    // Minimal std::allocator replacement so that standard containers that are part
+    // of the configuration tree (e.g. speed maps) can live in the arena too.
+    template <typename T>
+    struct ArenaAllocator {
+        using value_type = T;
+
+        ArenaAllocator() = default;
+        template <typename U>
+        ArenaAllocator(const ArenaAllocator<U>&) {}
+
+        T*   allocate(size_t n) { return static_cast<T*>(Arena::create(n * sizeof(T))); }
+        void deallocate(T* p, size_t) { Arena::destroy(p); }
+
+        template <typename U>
+        bool operator==(const ArenaAllocator<U>&) const {
+            return true;
+        }
+        template <typename U>
+        bool operator!=(const ArenaAllocator<U>&) const {
+            return false;
+        }
+    };
+}
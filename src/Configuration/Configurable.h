@@ -5,6 +5,7 @@
 
 #include "Generator.h"
 #include "Parser.h"
+#include "Arena.h"
 
 namespace Configuration {
     class HandlerBase;
@@ -24,6 +25,10 @@ namespace Configuration {
         virtual void afterParse() {}
         // virtual const char* name() const = 0;
 
+        // Configuration tree nodes are placed in the arena while a config is being loaded
+        static void* operator new(size_t size) { return Arena::create(size); }
+        static void  operator delete(void* p) { Arena::destroy(p); }
+
         virtual ~Configurable() {}
     };
 }
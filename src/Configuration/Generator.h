@@ -49,7 +49,7 @@ namespace Configuration {
             dst_ << name << ": " << value << '\n';
         }
 
-        void item(const char* name, std::vector<speedEntry>& value) {
+        void item(const char* name, SpeedMap& value) {
             indent();
             dst_ << name << ": ";
             if (value.size() == 0) {
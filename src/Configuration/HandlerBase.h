@@ -8,6 +8,7 @@
 #include "../EnumItem.h"
 #include "../SpindleDatatypes.h"
 #include "../UartTypes.h"
+#include "Arena.h"
 
 #include <IPAddress.h>
 
@@ -21,6 +22,8 @@ namespace Configuration {
         uint32_t     scale;
     } speedEntry;
 
+    using SpeedMap = std::vector<speedEntry, ArenaAllocator<speedEntry>>;
+
     template <typename BaseType>
     class GenericFactory;
 
@@ -50,7 +53,7 @@ namespace Configuration {
         }
 
         virtual void item(const char* name, float& value, float minValue = -3e38, float maxValue = 3e38)  = 0;
-        virtual void item(const char* name, std::vector<speedEntry>& value)                               = 0;
+        virtual void item(const char* name, SpeedMap& value)                                              = 0;
         virtual void item(const char* name, UartData& wordLength, UartParity& parity, UartStop& stopBits) = 0;
 
         virtual void item(const char* name, Pin& value)       = 0;
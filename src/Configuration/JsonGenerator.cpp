@@ -81,7 +81,7 @@ namespace Configuration {
         leave();
     }
 
-    void JsonGenerator::item(const char* name, std::vector<speedEntry>& value) {}
+    void JsonGenerator::item(const char* name, SpeedMap& value) {}
     void JsonGenerator::item(const char* name, UartData& wordLength, UartParity& parity, UartStop& stopBits) {
         // Not sure if I should comment this out or not. The implementation is similar to the one in Generator.h.
     }
@@ -68,11 +68,11 @@ namespace Configuration {
         return value;
     }
 
-    std::vector<speedEntry> Parser::speedEntryValue() const {
+    SpeedMap Parser::speedEntryValue() const {
         auto str = StringRange(token_.sValueStart_, token_.sValueEnd_);
 
-        std::vector<speedEntry> value;
-        StringRange             entryStr;
+        SpeedMap    value;
+        StringRange entryStr;
         for (entryStr = str.nextWord(); entryStr.length(); entryStr = str.nextWord()) {
             speedEntry  entry;
             StringRange speed = entryStr.nextWord('=');
@@ -26,7 +26,7 @@ namespace Configuration {
         StringRange             stringValue() const;
         bool                    boolValue() const;
         int                     intValue() const;
-        std::vector<speedEntry> speedEntryValue() const;
+        SpeedMap speedEntryValue() const;
         float                   floatValue() const;
         Pin                     pinValue() const;
         int                     enumValue(EnumItem* e) const;
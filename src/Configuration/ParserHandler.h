@@ -123,7 +123,7 @@ namespace Configuration {
             }
         }
 
-        void item(const char* name, std::vector<speedEntry>& value) override {
+        void item(const char* name, SpeedMap& value) override {
             if (_parser.is(name)) {
                 value = _parser.speedEntryValue();
             }
@@ -123,7 +123,7 @@ namespace Configuration {
         }
     }
 
-    void RuntimeSetting::item(const char* name, std::vector<speedEntry>& value) {
+    void RuntimeSetting::item(const char* name, SpeedMap& value) {
         if (is(name)) {
             isHandled_ = true;
             if (newValue_ == nullptr) {
@@ -140,8 +140,8 @@ namespace Configuration {
                 // Parser.cpp speedEntryValue(), albeit using String instead of
                 // StringRange.  It would be better to have a single String version,
                 // then pass it StringRange.str()
-                auto                    newStr = String(newValue_);
-                std::vector<speedEntry> smValue;
+                auto     newStr = String(newValue_);
+                SpeedMap smValue;
                 while (newStr.trim(), newStr.length()) {
                     speedEntry entry;
                     String     entryStr;
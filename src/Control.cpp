@@ -37,6 +37,17 @@ String Control::report() {
            _macro1.report() + _macro2.report() + _macro3.report();
 }
 
+void Control::report(ReportBuffer& pins) {
+    _safetyDoor.report(pins);
+    _reset.report(pins);
+    _feedHold.report(pins);
+    _cycleStart.report(pins);
+    _macro0.report(pins);
+    _macro1.report(pins);
+    _macro2.report(pins);
+    _macro3.report(pins);
+}
+
 bool Control::stuck() {
     return _safetyDoor.get() || _reset.get() || _feedHold.get() || _cycleStart.get() || _macro0.get() || _macro1.get() || _macro2.get() ||
            _macro3.get();
@@ -31,6 +31,7 @@ public:
     bool   stuck();
     bool   system_check_safety_door_ajar();
     String report();
+    void   report(ReportBuffer& pins);
 
     ~Control() = default;
 };
@@ -37,6 +37,12 @@ String ControlPin::report() {
     return get() ? String(_letter) : String("");
 }
 
+void ControlPin::report(ReportBuffer& pins) {
+    if (get()) {
+        pins << _letter;
+    }
+}
+
 ControlPin::~ControlPin() {
     _pin.detachInterrupt();
 }
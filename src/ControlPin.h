@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Pin.h"
+#include "ReportBuffer.h"
 
 class ControlPin {
 private:
@@ -23,6 +24,7 @@ public:
     bool get() { return _value; }
 
     String report();
+    void   report(ReportBuffer& pins);
 
     ~ControlPin();
 };
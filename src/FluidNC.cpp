@@ -18,6 +18,7 @@
 
 #include "WebUI/TelnetServer.h"
 #include "WebUI/Serial2Socket.h"
+#include "WebUI/JobStream.h"
 #include "WebUI/InputBuffer.h"
 
 #ifdef ENABLE_WIFI
@@ -44,6 +45,9 @@ void main_init() {
         // because the polling may depend on the config
         client_init();
 
+        // From here on log messages go through the drain task
+        logging_init();
+
         if (!SPIFFS.begin(true)) {
             log_error("Cannot mount the local filesystem");
         }
@@ -124,12 +128,15 @@ void main_init() {
 
 #ifdef ENABLE_WIFI
         WebUI::wifi_config.begin();
-        register_client(&WebUI::Serial2Socket);
-        register_client(&WebUI::telnet_server);
+        register_client(&WebUI::Serial2Socket, WebUI::Serial_2_Socket::RXBUFFERSIZE, OutputPolicy::Drop, "wsOut");
+        register_client(&WebUI::jobStream, WebUI::JobStream::WINDOW);
+        for (auto session : WebUI::telnet_server.sessions()) {
+            register_client(session, WebUI::Telnet_Session::RXBUFFERSIZE, OutputPolicy::Drop, "telnetOut");
+        }
 #endif
 #ifdef ENABLE_BLUETOOTH
         WebUI::bt_config.begin();
-        register_client(&WebUI::SerialBT);
+        register_client(&WebUI::SerialBT, 0, OutputPolicy::Drop, "btOut");
 #endif
         WebUI::inputBuffer.begin();
     } catch (const AssertionFailed& ex) {
@@ -506,6 +506,11 @@ void IRAM_ATTR i2s_out_write(pinnum_t pin, uint8_t val) {
     }
 }
 
+void IRAM_ATTR i2s_out_write_masks(uint32_t set, uint32_t clear) {
+    uint32_t expected = atomic_load(&i2s_out_port_data);
+    while (!atomic_compare_exchange_weak(&i2s_out_port_data, &expected, (expected | set) & ~clear)) {}
+}
+
 uint8_t i2s_out_read(pinnum_t pin) {
     uint32_t port_data = atomic_load(&i2s_out_port_data);
     return (!!(port_data & bitnum_to_mask(pin)));
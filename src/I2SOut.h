@@ -91,6 +91,13 @@ void i2s_out_push();
 */
 void i2s_out_write(pinnum_t pin, uint8_t val);
 
+/*
+   Set and clear several bits of the internal pin state var at once.
+   set:   bits to set
+   clear: bits to clear
+*/
+void i2s_out_write_masks(uint32_t set, uint32_t clear);
+
 /*
     Set current pin state to the I2S bitstream buffer
     (This call will generate a future I2S_OUT_USEC_PER_PULSE μs x N bitstream)
@@ -4,9 +4,8 @@
 #include "Logging.h"
 #include "SettingsDefinitions.h"
 
-
-volatile bool prh_in_out = false;
-
+#include <atomic>
+#include <cstring>
 
 #ifndef ESP32
 
@@ -16,25 +15,204 @@ volatile bool prh_in_out = false;
 bool atMsgLevel(MsgLevel level) {
     return message_level == nullptr || message_level->get() >= level;
 }
+
+static void write_record(const char* text, size_t len) {
+    DEBUG_OUT.write(text, len);
+}
 #else
+#    include "Serial.h"  // allClients
+
+#    include <freertos/FreeRTOS.h>
+#    include <freertos/task.h>
+
 #    define DEBUG_OUT allClients
 bool atMsgLevel(MsgLevel level) {
     return message_level == nullptr || message_level->get() >= level;
 }
+
+static void write_record(const char* text, size_t len) {
+    DEBUG_OUT.write(reinterpret_cast<const uint8_t*>(text), len);
+}
+#endif
+
+// Bounded lock-free multi-producer single-consumer ring of fixed-size log
+// records, after Dmitry Vyukov's bounded queue.  Every slot carries a sequence
+// number that tells producers and the consumer whose turn it is, so tasks that
+// log at the same time only contend on one compare-and-swap and never wait for
+// the drain task.  When the ring is full the message is dropped and counted.
+namespace {
+    struct LogRecord {
+        std::atomic<uint32_t> seq;
+        uint16_t              len;
+        char                  text[DebugStream::maxRecord];
+    };
+
+    const uint32_t ringSize = 16;  // Must be a power of 2
+    const uint32_t ringMask = ringSize - 1;
+
+    LogRecord             ring[ringSize];
+    std::atomic<uint32_t> enqueuePos(0);
+    std::atomic<uint32_t> dequeuePos(0);  // Only advanced by the drain task
+    std::atomic<uint32_t> dropped(0);
+
+    bool enqueue(const char* text, size_t len) {
+        uint32_t pos = enqueuePos.load(std::memory_order_relaxed);
+        while (true) {
+            LogRecord& record = ring[pos & ringMask];
+            int32_t    diff   = int32_t(record.seq.load(std::memory_order_acquire) - pos);
+            if (diff == 0) {
+                // The slot is free; claim it by advancing the enqueue position
+                if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    memcpy(record.text, text, len);
+                    record.len = len;
+                    record.seq.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                // The consumer has not freed this slot yet, so the ring is full
+                return false;
+            } else {
+                // Another producer claimed the slot first
+                pos = enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    LogRecord* front() {
+        uint32_t   pos    = dequeuePos.load(std::memory_order_relaxed);
+        LogRecord& record = ring[pos & ringMask];
+        return record.seq.load(std::memory_order_acquire) == pos + 1 ? &record : nullptr;
+    }
+
+    void pop() {
+        uint32_t pos = dequeuePos.load(std::memory_order_relaxed);
+        ring[pos & ringMask].seq.store(pos + ringSize, std::memory_order_release);
+        dequeuePos.store(pos + 1, std::memory_order_relaxed);
+    }
+}
+
+#ifdef ESP32
+static TaskHandle_t  logDrainTaskHandle = nullptr;
+static volatile bool logDraining        = false;
+
+// Collects queued records into one buffer so that each client gets a few
+// large writes instead of one write per character.
+static void logDrainTask(void* pvParameters) {
+    const TickType_t drainInterval = 50 / portTICK_PERIOD_MS;
+    char             batch[1024];
+    uint32_t         reportedDrops = 0;
+
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, drainInterval);
+        logDraining = true;
+
+        size_t     len = 0;
+        LogRecord* record;
+        while ((record = front()) != nullptr) {
+            if (len + record->len > sizeof(batch)) {
+                write_record(batch, len);
+                len = 0;
+            }
+            memcpy(batch + len, record->text, record->len);
+            len += record->len;
+            pop();
+        }
+
+        uint32_t drops = dropped.load(std::memory_order_relaxed);
+        if (drops != reportedDrops && len + 64 <= sizeof(batch)) {
+            len += snprintf(batch + len, 64, "[MSG:WARN: %u log messages dropped]\n", unsigned(drops - reportedDrops));
+            reportedDrops = drops;
+        }
+
+        if (len) {
+            write_record(batch, len);
+        }
+        logDraining = false;
+    }
+}
+
+void logging_flush() {
+    if (!logDrainTaskHandle) {
+        return;
+    }
+    xTaskNotifyGive(logDrainTaskHandle);
+    for (int i = 0; i < 100; i++) {
+        if (enqueuePos.load() == dequeuePos.load() && !logDraining) {
+            return;
+        }
+        vTaskDelay(1);
+    }
+}
+
+void logging_init() {
+    if (logDrainTaskHandle) {
+        return;
+    }
+    for (uint32_t i = 0; i < ringSize; i++) {
+        ring[i].seq.store(i, std::memory_order_relaxed);
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+    xTaskCreatePinnedToCore(logDrainTask,        // task
+                            "logDrainTask",      // name for task
+                            3072,                // size of task stack
+                            NULL,                // parameters
+                            1,                   // priority
+                            &logDrainTaskHandle,
+                            CONFIG_ARDUINO_RUNNING_CORE  // same core as the main loop
+    );
+}
+
+static bool queue_record(const char* text, size_t len) {
+    if (!logDrainTaskHandle) {
+        return false;
+    }
+    if (!enqueue(text, len)) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+    xTaskNotifyGive(logDrainTaskHandle);
+    return true;
+}
+#else
+// On the host there is no drain task and messages are written directly
+void logging_init() {}
+void logging_flush() {}
+
+static bool queue_record(const char* text, size_t len) {
+    return false;
+}
 #endif
 
-DebugStream::DebugStream(const char* name) {
-    while (prh_in_out) vTaskDelay(1);
-    prh_in_out = true;
-    DEBUG_OUT << "[MSG:" << name << ": ";
+uint32_t logging_dropped() {
+    return dropped.load(std::memory_order_relaxed);
+}
+
+DebugStream::DebugStream(const char* name) : _len(0) {
+    *this << "[MSG:" << name << ": ";
 }
 
 size_t DebugStream::write(uint8_t c) {
-    DEBUG_OUT << static_cast<char>(c);
+    // Keep room for the closing "]\n"
+    if (_len < maxRecord - 2) {
+        _buf[_len++] = char(c);
+    }
     return 1;
 }
 
+size_t DebugStream::write(const uint8_t* buffer, size_t length) {
+    size_t n = length;
+    if (n > maxRecord - 2 - _len) {
+        n = maxRecord - 2 - _len;
+    }
+    memcpy(_buf + _len, buffer, n);
+    _len += n;
+    return length;
+}
+
 DebugStream::~DebugStream() {
-    DEBUG_OUT << "]\n";
-    prh_in_out = false;
+    _buf[_len++] = ']';
+    _buf[_len++] = '\n';
+    if (!queue_record(_buf, _len)) {
+        write_record(_buf, _len);
+    }
 }
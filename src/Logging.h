@@ -29,15 +29,37 @@ enum MsgLevel {
 
 #include "MyIOStream.h"
 
+// A DebugStream formats one log message into its own buffer on the stack of
+// the logging task.  The destructor hands the finished message to a lock-free
+// ring that a low-priority task drains to the clients, so logging never waits
+// on other tasks or on slow client output.  Messages longer than maxRecord
+// are truncated.
 class DebugStream : public Print {
 public:
+    static const size_t maxRecord = 256;
+
     DebugStream(const char* name);
     size_t write(uint8_t c) override;
+    size_t write(const uint8_t* buffer, size_t length) override;
     ~DebugStream();
+
+private:
+    char   _buf[maxRecord];
+    size_t _len;
 };
 
 extern bool atMsgLevel(MsgLevel level);
 
+// Starts the task that drains queued log messages to the clients.  Until it
+// runs, messages are written directly.
+void logging_init();
+
+// Waits briefly for queued log messages to be handed to the clients
+void logging_flush();
+
+// Number of log messages discarded because the ring was full
+uint32_t logging_dropped();
+
 // Note: these '{'..'}' scopes are here for a reason: the destructor should flush.
 #define log_debug(x)                                                                                                                       \
     if (atMsgLevel(MsgLevelDebug)) {                                                                                                       \
@@ -50,6 +50,39 @@ namespace Machine {
         }
 
         config_motors();
+
+        build_pin_sets();
+    }
+
+    // Collapse the step and direction pins of plain step/dir motors into
+    // register masks, so the stepper ISR can set them with one write per
+    // register instead of a chain of virtual calls per motor.
+    void Axes::build_pin_sets() {
+        _batchedMotors = 0;
+        _unstepMasks   = Pins::PortMasks();
+
+        int nBatched = 0;
+        for (size_t axis = X_AXIS; axis < _numberAxis; axis++) {
+            for (size_t motor = 0; motor < Axis::MAX_MOTORS_PER_AXIS; motor++) {
+                auto& step = _stepPins[axis][motor];
+                auto& dir  = _dirPins[axis][motor];
+                step.clear();
+                dir.clear();
+
+                auto m = _axis[axis]->_motors[motor];
+                if (m && m->_driver->add_step_dir_pins(step, dir)) {
+                    set_bitnum(_batchedMotors, motor * 16 + axis);
+                    _unstepMasks |= step.off();
+                    ++nBatched;
+                } else {
+                    step.clear();
+                    dir.clear();
+                }
+            }
+        }
+        if (nBatched) {
+            log_info("Step/dir pins of " << nBatched << " motors use port masks");
+        }
     }
 
     void IRAM_ATTR Axes::set_disable(int axis, bool disable) {
@@ -109,47 +142,61 @@ namespace Machine {
         if (dir_mask != previous_dir) {
             previous_dir = dir_mask;
 
+            Pins::PortMasks dirMasks;
             for (int axis = X_AXIS; axis < n_axis; axis++) {
                 bool thisDir = bitnum_is_true(dir_mask, axis);
 
                 for (size_t motor = 0; motor < Axis::MAX_MOTORS_PER_AXIS; motor++) {
-                    auto m = _axis[axis]->_motors[motor];
-                    if (m) {
-                        m->_driver->set_direction(thisDir);
+                    if (bitnum_is_true(_batchedMotors, motor * 16 + axis)) {
+                        dirMasks |= _dirPins[axis][motor].value(thisDir);
+                    } else {
+                        auto m = _axis[axis]->_motors[motor];
+                        if (m) {
+                            m->_driver->set_direction(thisDir);
+                        }
                     }
                 }
             }
+            dirMasks.write();
             config->_stepping->waitDirection();
         }
 
         // Turn on step pulses for motors that are supposed to step now
+        Pins::PortMasks stepMasks;
         for (size_t axis = X_AXIS; axis < n_axis; axis++) {
             if (bitnum_is_true(step_mask, axis)) {
                 auto a = _axis[axis];
 
-                if (bitnum_is_false(_motorLockoutMask, axis)) {
-                    auto m = a->_motors[0];
-                    if (m) {
-                        m->_driver->step();
+                for (size_t motor = 0; motor < Axis::MAX_MOTORS_PER_AXIS; motor++) {
+                    auto bit = motor * 16 + axis;
+                    if (bitnum_is_true(_motorLockoutMask, bit)) {
+                        continue;
                     }
-                }
-                if (bitnum_is_false(_motorLockoutMask, axis + 16)) {
-                    auto m = a->_motors[1];
-                    if (m) {
-                        m->_driver->step();
+                    if (bitnum_is_true(_batchedMotors, bit)) {
+                        stepMasks |= _stepPins[axis][motor].on();
+                    } else {
+                        auto m = a->_motors[motor];
+                        if (m) {
+                            m->_driver->step();
+                        }
                     }
                 }
             }
         }
+        stepMasks.write();
         config->_stepping->startPulseTimer();
     }
 
     // Turn all stepper pins off
     void IRAM_ATTR Axes::unstep() {
         config->_stepping->waitPulse();
+        _unstepMasks.write();
         auto n_axis = _numberAxis;
         for (size_t axis = X_AXIS; axis < n_axis; axis++) {
             for (size_t motor = 0; motor < Axis::MAX_MOTORS_PER_AXIS; motor++) {
+                if (bitnum_is_true(_batchedMotors, motor * 16 + axis)) {
+                    continue;
+                }
                 auto m = _axis[axis]->_motors[motor];
                 if (m) {
                     m->_driver->unstep();
@@ -5,6 +5,7 @@
 #pragma once
 
 #include "../Configuration/Configurable.h"
+#include "../Pins/PinSet.h"
 #include "Axis.h"
 
 namespace MotorDrivers {
@@ -20,6 +21,16 @@ namespace Machine {
         // reached their limit switches, by clearing bits in the mask.
         MotorMask _motorLockoutMask = 0;
 
+        // Motors whose step and direction pins are driven through the
+        // precomputed masks below rather than through their drivers.
+        // Bit numbering is the same as for _motorLockoutMask.
+        MotorMask       _batchedMotors = 0;
+        Pins::PinSet    _stepPins[MAX_N_AXIS][Axis::MAX_MOTORS_PER_AXIS];
+        Pins::PinSet    _dirPins[MAX_N_AXIS][Axis::MAX_MOTORS_PER_AXIS];
+        Pins::PortMasks _unstepMasks;
+
+        void build_pin_sets();
+
     public:
         static constexpr const char* _names = "XYZABC";
 
@@ -6,6 +6,7 @@
 #include "../MotionControl.h"  // mc_reset
 #include "../GLimits.h"
 #include "../Protocol.h"  // rtAlarm
+#include "../Trace.h"
 
 #include <esp32-hal-gpio.h>  // CHANGE
 
@@ -47,6 +48,7 @@ namespace Machine {
     void IRAM_ATTR LimitPin::handleISR() {
         bool pinState = _pin.read();
         _value        = _pin.read();
+        TRACE(Limit, _value, _bitmask);
         // log_debug("LimitPin::handleISR(" << String(_bitmask,HEX) << ") value=" << _value);
         if (_value)
         {
@@ -16,6 +16,7 @@
 #include "../Configuration/Validator.h"
 #include "../Configuration/AfterParse.h"
 #include "../Configuration/ParseException.h"
+#include "../Configuration/Arena.h"
 #include "../Config.h"  // ENABLE_*
 
 #include <SPIFFS.h>
@@ -180,6 +181,23 @@ namespace Machine {
         return filesize;
     }
 
+    void MachineConfig::reportArena(uint32_t heapBefore) {
+        using Configuration::Arena;
+
+        log_info("Config arena: " << Arena::allocations() << " objects, " << Arena::used() << " of " << Arena::reserved() << " bytes in "
+                                  << Arena::blocks() << " blocks (~" << Arena::heapEquivalent() << " bytes as separate allocations)");
+        log_debug("Heap used by configuration: " << (heapBefore - uint32_t(xPortGetFreeHeapSize())));
+    }
+
+    void MachineConfig::unload() {
+        // Destructors still run so that pins and peripherals are released,
+        // but the memory of everything that was placed in the arena is
+        // returned in one step afterwards.
+        delete config;
+        config = nullptr;
+        Configuration::Arena::release();
+    }
+
     char defaultConfig[] = "name: Default (Test Drive)\nboard: None\n";
 
     bool MachineConfig::load(const char* filename) {
@@ -196,22 +214,28 @@ namespace Machine {
             filesize = readFile(filename, buffer);
         }
 
-        StringRange* input = nullptr;
+        StringRange input;
 
         if (filesize > 0) {
-            input = new StringRange(buffer, buffer + filesize);
+            input = StringRange(buffer, buffer + filesize);
             log_info("Configuration file: " << filename);
 
         } else {
             log_info("Using default configuration");
-            input = new StringRange(defaultConfig);
+            input = StringRange(defaultConfig);
         }
+
+        // Everything the parser and the after-parse fixups create becomes part of
+        // the configuration tree, so it is placed in the arena as a unit.
+        uint32_t heapBefore = xPortGetFreeHeapSize();
+        Configuration::Arena::open();
+
         // Process file:
         bool successful = false;
         try {
             // log_info("Heap size before parsing is " << uint32_t(xPortGetFreeHeapSize()));
 
-            Configuration::Parser        parser(input->begin(), input->end());
+            Configuration::Parser        parser(input.begin(), input.end());
             Configuration::ParserHandler handler(parser);
 
             // instaniate base class config is no pointer present
@@ -275,10 +299,13 @@ namespace Machine {
             log_error("Unknown error while processing config file");
         }
 
+        Configuration::Arena::close();
+
         if (buffer) {
             delete[] buffer;
         }
-        delete[] input;
+
+        reportArena(heapBefore);
 
         std::atomic_thread_fence(std::memory_order::memory_order_seq_cst);
 
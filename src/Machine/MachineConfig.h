@@ -99,6 +99,10 @@ namespace Machine {
 
         static size_t readFile(const char* file, char*& buffer);
         static bool   load(const char* file);
+        static void   reportArena(uint32_t heapBefore);
+
+        // Tears down the configuration tree and releases its arena.
+        static void unload();
 
         ~MachineConfig();
     };
@@ -0,0 +1,74 @@
+// Copyright (c) 2021 -  FluidNC contributors
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#pragma once
+
+// Modbus RTU framing, independent of the transport so that it can be
+// tested on the host.
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Modbus {
+    static const size_t maxFrame = 256;  // Longest RTU frame, including address and CRC
+
+    // CRC-16/MODBUS over len bytes
+    uint16_t crc16(const uint8_t* buf, size_t len);
+
+    // Appends the CRC, low byte first, to a frame of len bytes and returns
+    // the new length
+    size_t appendCrc(uint8_t* frame, size_t len);
+
+    // The silence that ends a frame, 3.5 character times.  Above 19200 baud
+    // the spec fixes it at 1750 us.
+    uint32_t interFrameUs(uint32_t baud);
+
+    // Receives one response frame.  The frame ends when the expected number
+    // of bytes has arrived, or when the line has been silent for the
+    // inter-frame time after the last byte, so a reply is taken as soon as
+    // it is complete instead of after a fixed timeout.  The caller reads
+    // whatever the transport has and hands it to feed(), also when nothing
+    // arrived, so that the timeouts are checked.
+    class FrameReceiver {
+    public:
+        enum class State : uint8_t {
+            Waiting,    // For the first byte
+            Receiving,  // Until the expected length or a silent gap
+            Complete,
+            Timeout,   // No response
+            Overflow,  // More than maxFrame bytes
+        };
+
+        // expected is the length of a normal response including the CRC,
+        // or 0 if it is not known.  An exception response is always 5 bytes.
+        void begin(uint8_t id, size_t expected, uint32_t responseUs, uint32_t gapUs, uint32_t nowUs);
+
+        State feed(const uint8_t* data, size_t len, uint32_t nowUs);
+
+        State state() const { return _state; }
+        bool  receiving() const { return _state == State::Waiting || _state == State::Receiving; }
+
+        // The most that can usefully be read for this frame
+        size_t wanted() const { return (_expected ? _expected : maxFrame) - _len; }
+
+        // A complete frame from the addressed device with a good CRC
+        bool valid() const;
+
+        // A valid frame that reports a Modbus exception
+        bool    exception() const { return valid() && (_buf[1] & 0x80); }
+        uint8_t exceptionCode() const { return _buf[2]; }
+
+        const uint8_t* data() const { return _buf; }
+        size_t         length() const { return _len; }
+
+    private:
+        uint8_t  _buf[maxFrame];
+        size_t   _len      = 0;
+        size_t   _expected = 0;
+        uint8_t  _id       = 0;
+        State    _state    = State::Timeout;
+        uint32_t _responseUs;
+        uint32_t _gapUs;
+        uint32_t _lastUs;  // When the request went out or the last byte arrived
+    };
+}
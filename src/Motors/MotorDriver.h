@@ -26,6 +26,10 @@
 
 #include <cstdint>
 
+namespace Pins {
+    class PinSet;
+}
+
 namespace MotorDrivers {
     class MotorDriver : public Configuration::Configurable {
     public:
@@ -78,6 +82,12 @@ namespace MotorDrivers {
         // states of the step pins are unknown.
         virtual void unstep() {}
 
+        // add_step_dir_pins() lets Axes drive this motor's step and
+        // direction pins through precomputed port masks instead of calling
+        // step(), unstep() and set_direction().  It is called once after
+        // init().  Returns false if the motor needs the per-motor calls.
+        virtual bool add_step_dir_pins(Pins::PinSet& step, Pins::PinSet& dir) { return false; }
+
         // this is used to configure and test motors. This would be used for Trinamic
         virtual void config_motor() {}
 
@@ -10,6 +10,7 @@
 #include "../Machine/MachineConfig.h"
 #include "../Stepper.h"   // ST_I2S_*
 #include "../Stepping.h"  // config->_stepping->_engine
+#include "../Pins/PinSet.h"
 
 #include <esp32-hal-gpio.h>  // gpio
 
@@ -107,6 +108,14 @@ namespace MotorDrivers {
 
     void IRAM_ATTR StandardStepper::set_disable(bool disable) { _disable_pin.synchronousWrite(disable); }
 
+    bool StandardStepper::add_step_dir_pins(Pins::PinSet& step, Pins::PinSet& dir) {
+        // RMT generates the step pulse in hardware, so only the pin based engines qualify
+        if (config->_stepping->_engine == Stepping::RMT) {
+            return false;
+        }
+        return step.add(_step_pin) && dir.add(_dir_pin);
+    }
+
     // Configuration registration
     namespace {
         MotorFactory::InstanceBuilder<StandardStepper> registration("standard_stepper");
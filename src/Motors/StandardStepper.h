@@ -20,6 +20,7 @@ namespace MotorDrivers {
         void set_direction(bool) override;
         void step() override;
         void unstep() override;
+        bool add_step_dir_pins(Pins::PinSet& step, Pins::PinSet& dir) override;
         void read_settings() override;
 
         void init_step_dir_pins();
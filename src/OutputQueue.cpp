@@ -0,0 +1,172 @@
+// Copyright (c) 2021 -  FluidNC contributors
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#include "OutputQueue.h"
+
+#include <cstring>
+
+static OutputChunk   chunkPool[OutputChunk::poolSize];
+static QueueHandle_t freeChunks = nullptr;
+
+void OutputChunk::initPool() {
+    if (freeChunks) {
+        return;
+    }
+    freeChunks = xQueueCreate(poolSize, sizeof(OutputChunk*));
+    for (int i = 0; i < poolSize; i++) {
+        OutputChunk* chunk = &chunkPool[i];
+        xQueueSend(freeChunks, &chunk, 0);
+    }
+}
+
+OutputChunk* OutputChunk::allocate(TickType_t wait) {
+    OutputChunk* chunk;
+    if (!freeChunks || xQueueReceive(freeChunks, &chunk, wait) != pdTRUE) {
+        return nullptr;
+    }
+    chunk->refs = 1;
+    chunk->len  = 0;
+    return chunk;
+}
+
+int OutputChunk::available() {
+    return freeChunks ? uxQueueMessagesWaiting(freeChunks) : 0;
+}
+
+void OutputChunk::release() {
+    if (refs.fetch_sub(1) == 1) {
+        OutputChunk* chunk = this;
+        xQueueSend(freeChunks, &chunk, 0);
+    }
+}
+
+OutputQueue::OutputQueue(Print* transport, OutputPolicy policy, const char* name) :
+    _sentBytes(0), _dropped(0), _stalls(0), _highWater(0), _transport(transport), _policy(policy), _stage(nullptr), _busy(false) {
+    OutputChunk::initPool();
+    _queue     = xQueueCreate(depth, sizeof(OutputChunk*));
+    _stageLock = xSemaphoreCreateMutex();
+    xTaskCreatePinnedToCore(drainTask,  // task
+                            name,       // name for task
+                            3072,       // size of task stack
+                            this,       // parameters
+                            1,          // priority
+                            NULL,
+                            CONFIG_ARDUINO_RUNNING_CORE  // same core as the main loop
+    );
+}
+
+bool OutputQueue::enqueue(OutputChunk* chunk, TickType_t wait) {
+    if (uxQueueSpacesAvailable(_queue) == 0) {
+        if (!wait) {
+            ++_dropped;
+            return false;
+        }
+        ++_stalls;
+    }
+    if (xQueueSend(_queue, &chunk, wait) != pdTRUE) {
+        ++_dropped;
+        return false;
+    }
+    uint32_t queued = uxQueueMessagesWaiting(_queue);
+    if (queued > _highWater) {
+        _highWater = queued;
+    }
+    return true;
+}
+
+bool OutputQueue::broadcast(OutputChunk* chunk) {
+    chunk->addRef();
+    if (!enqueue(chunk, _policy == OutputPolicy::Block ? blockMs / portTICK_PERIOD_MS : 0)) {
+        chunk->release();
+        return false;
+    }
+    return true;
+}
+
+// Must be called with _stageLock held
+void OutputQueue::queueStage() {
+    if (_stage && _stage->len) {
+        // A reply that cannot be queued after blockMs is lost, but the
+        // writer is never stuck behind a transport that has gone away.
+        if (!enqueue(_stage, blockMs / portTICK_PERIOD_MS)) {
+            _stage->release();
+        }
+        _stage = nullptr;
+    }
+}
+
+size_t OutputQueue::write(uint8_t c) {
+    return write(&c, 1);
+}
+
+size_t OutputQueue::write(const uint8_t* buffer, size_t length) {
+    xSemaphoreTake(_stageLock, portMAX_DELAY);
+    size_t done = 0;
+    while (done < length) {
+        if (!_stage) {
+            _stage = OutputChunk::allocate(blockMs / portTICK_PERIOD_MS);
+            if (!_stage) {
+                ++_dropped;
+                break;
+            }
+        }
+        size_t n = length - done;
+        if (n > OutputChunk::capacity - _stage->len) {
+            n = OutputChunk::capacity - _stage->len;
+        }
+        memcpy(_stage->data + _stage->len, buffer + done, n);
+        _stage->len += n;
+        done += n;
+        if (_stage->len == OutputChunk::capacity) {
+            queueStage();
+        }
+    }
+    if (_stage && _stage->len && _stage->data[_stage->len - 1] == '\n') {
+        queueStage();
+    }
+    xSemaphoreGive(_stageLock);
+    return length;
+}
+
+void OutputQueue::flush() {
+    xSemaphoreTake(_stageLock, portMAX_DELAY);
+    queueStage();
+    xSemaphoreGive(_stageLock);
+}
+
+bool OutputQueue::waitEmpty(TickType_t timeout) {
+    flush();
+    TickType_t start = xTaskGetTickCount();
+    while (uxQueueMessagesWaiting(_queue) || _busy) {
+        if ((xTaskGetTickCount() - start) >= timeout) {
+            return false;
+        }
+        vTaskDelay(1);
+    }
+    return true;
+}
+
+// Coalesces whatever is queued into one buffer so the transport sees a few
+// large writes rather than one per line.
+void OutputQueue::drainTask(void* pvParameters) {
+    auto         queue = static_cast<OutputQueue*>(pvParameters);
+    char         batch[4 * OutputChunk::capacity];
+    OutputChunk* chunk;
+
+    while (true) {
+        if (xQueueReceive(queue->_queue, &chunk, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+        queue->_busy = true;
+        size_t len   = 0;
+        do {
+            memcpy(batch + len, chunk->data, chunk->len);
+            len += chunk->len;
+            chunk->release();
+        } while (len + OutputChunk::capacity <= sizeof(batch) && xQueueReceive(queue->_queue, &chunk, 0) == pdTRUE);
+
+        queue->_transport->write(reinterpret_cast<const uint8_t*>(batch), len);
+        queue->_sentBytes += len;
+        queue->_busy = false;
+    }
+}
@@ -0,0 +1,88 @@
+// Copyright (c) 2021 -  FluidNC contributors
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#pragma once
+
+#include <Print.h>
+#include <atomic>
+#include <cstdint>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+
+// How a client's output queue treats broadcast output (AllClients) when the
+// client cannot keep up.  Replies to the client's own commands are never
+// dropped lightly; see OutputQueue::write().
+enum class OutputPolicy : uint8_t {
+    Direct,  // No queue, output is written to the transport synchronously
+    Block,   // Broadcasts wait up to blockMs for room in the queue
+    Drop,    // Broadcasts that do not fit are dropped and counted
+};
+
+// Output travels in fixed-size chunks taken from a shared pool, so queueing
+// never touches the heap.  A broadcast is formatted into a chunk once and
+// that chunk is referenced by every queue it is placed in; the last queue
+// to send it returns it to the pool.
+struct OutputChunk {
+    static const size_t capacity = 248;
+    static const int    poolSize = 32;
+
+    std::atomic<uint32_t> refs;
+    uint16_t              len;
+    char                  data[capacity];
+
+    // Returns nullptr if no chunk became free within wait
+    static OutputChunk* allocate(TickType_t wait);
+    static void         initPool();
+    static int          available();
+
+    void addRef() { refs.fetch_add(1); }
+    void release();
+};
+
+// A bounded queue of chunks in front of one client's transport, drained by
+// its own low-priority task.  A client whose transport is slow therefore
+// only delays its own output, not the main loop or the other clients.
+class OutputQueue : public Print {
+public:
+    static const int      depth   = 16;   // chunks
+    static const uint32_t blockMs = 100;  // longest wait for room
+
+    OutputQueue(Print* transport, OutputPolicy policy, const char* name);
+
+    // Output for this client alone.  Bytes are collected into a chunk that
+    // is queued at the end of each line or when it is full.
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t* buffer, size_t length) override;
+
+    // Queues a partial line, for output that is not newline-terminated
+    void flush() override;
+
+    // Queues a chunk that is shared with other clients, following the policy
+    bool broadcast(OutputChunk* chunk);
+
+    // Waits until everything queued so far has been handed to the transport
+    bool waitEmpty(TickType_t timeout);
+
+    Print*       transport() const { return _transport; }
+    OutputPolicy policy() const { return _policy; }
+
+    // Counters, for $Clients/Stats
+    std::atomic<uint32_t> _sentBytes;
+    std::atomic<uint32_t> _dropped;    // chunks
+    std::atomic<uint32_t> _stalls;     // writes that had to wait for room
+    uint32_t              _highWater;  // most chunks queued at once
+
+private:
+    Print*            _transport;
+    OutputPolicy      _policy;
+    QueueHandle_t     _queue;
+    SemaphoreHandle_t _stageLock;
+    OutputChunk*      _stage;  // Partial line collected by write()
+    volatile bool     _busy;
+
+    bool        enqueue(OutputChunk* chunk, TickType_t wait);
+    void        queueStage();
+    static void drainTask(void* pvParameters);
+};
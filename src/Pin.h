@@ -18,6 +18,9 @@
 
 // Forward declarations:
 class String;
+namespace Pins {
+    class PinSet;
+}
 
 // Pin class. A pin is basically a thing that can 'output', 'input' or do both. GPIO on an ESP32 comes to mind,
 // but there are way more possible pins. Think about I2S/I2C/SPI extenders, RS485 driven pin devices and even
@@ -62,6 +65,8 @@ class Pin {
 
     static const char* parse(StringRange str, Pins::PinDetail*& detail);
 
+    friend class Pins::PinSet;
+
     inline Pin(Pins::PinDetail* detail) : _detail(detail) {}
 
 public:
@@ -6,6 +6,7 @@
 #include <stdexcept>
 
 #include "GPIOPinDetail.h"
+#include "PinSet.h"
 #include "../Assert.h"
 #include "../Logging.h"
 
@@ -183,6 +184,19 @@ namespace Pins {
         ::detachInterrupt(_index);
     }
 
+    bool GPIOPinDetail::addToMasks(PortMasks& on, PortMasks& off) const {
+        auto     word = _index / 32;
+        uint32_t bit  = uint32_t(1) << (_index % 32);
+        if (_readWriteMask) {
+            on.gpioClear[word] |= bit;
+            off.gpioSet[word] |= bit;
+        } else {
+            on.gpioSet[word] |= bit;
+            off.gpioClear[word] |= bit;
+        }
+        return true;
+    }
+
     String GPIOPinDetail::toString() {
         auto s = String("gpio.") + int(_index);
         if (_attributes.has(PinAttributes::ActiveLow)) {
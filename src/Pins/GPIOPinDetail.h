@@ -32,6 +32,8 @@ namespace Pins {
         void attachInterrupt(void (*callback)(void*), void* arg, int mode) override;
         void detachInterrupt() override;
 
+        bool addToMasks(PortMasks& on, PortMasks& off) const override;
+
         String toString() override;
 
         ~GPIOPinDetail() override { _claimed[_index] = false; }
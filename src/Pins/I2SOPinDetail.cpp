@@ -3,6 +3,7 @@
 
 #ifdef ESP32
 #    include "I2SOPinDetail.h"
+#    include "PinSet.h"
 
 #    include "../I2SOut.h"
 #    include "../Assert.h"
@@ -72,6 +73,18 @@ namespace Pins {
 
     PinAttributes I2SOPinDetail::getAttr() const { return _attributes; }
 
+    bool I2SOPinDetail::addToMasks(PortMasks& on, PortMasks& off) const {
+        uint32_t bit = uint32_t(1) << _index;
+        if (_readWriteMask) {
+            on.i2soClear |= bit;
+            off.i2soSet |= bit;
+        } else {
+            on.i2soSet |= bit;
+            off.i2soClear |= bit;
+        }
+        return true;
+    }
+
     String I2SOPinDetail::toString() {
         auto s = String("I2SO.") + int(_index);
         if (_attributes.has(PinAttributes::ActiveLow)) {
@@ -27,6 +27,8 @@ namespace Pins {
         void          setAttr(PinAttributes value) override;
         PinAttributes getAttr() const override;
 
+        bool addToMasks(PortMasks& on, PortMasks& off) const override;
+
         String toString() override;
 
         ~I2SOPinDetail() override { _claimed[_index] = false; }
@@ -6,6 +6,7 @@
 #include "PinCapabilities.h"
 #include "PinAttributes.h"
 #include "PinOptionsParser.h"
+#include "../Configuration/Arena.h"
 
 #include <WString.h>
 #include <cstdint>
@@ -15,6 +16,7 @@
 typedef uint8_t pinnum_t;
 
 namespace Pins {
+    struct PortMasks;
 
     // Implementation details of pins.
     class PinDetail {
@@ -41,10 +43,18 @@ namespace Pins {
         virtual void attachInterrupt(void (*callback)(void*), void* arg, int mode);
         virtual void detachInterrupt();
 
+        // Adds this pin to precomputed on/off register masks (see PinSet).
+        // Returns false if the pin cannot be driven that way.
+        virtual bool addToMasks(PortMasks& on, PortMasks& off) const { return false; }
+
         virtual String toString() = 0;
 
         inline int number() const { return _index; }
 
+        // Pins created by the config parser live in the configuration arena
+        static void* operator new(size_t size) { return Configuration::Arena::create(size); }
+        static void  operator delete(void* p) { Configuration::Arena::destroy(p); }
+
         virtual ~PinDetail() {}
     };
 }
@@ -0,0 +1,63 @@
+// Copyright (c) 2021 -  FluidNC contributors
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#include "PinSet.h"
+
+#include "../Pin.h"
+
+#ifdef ESP32
+#    include "../I2SOut.h"
+#    include <soc/gpio_struct.h>  // GPIO
+#else
+extern "C" void __digitalWrite(pinnum_t pin, uint8_t val);
+#endif
+
+namespace Pins {
+#ifdef ESP32
+    void IRAM_ATTR PortMasks::write() const {
+        if (gpioSet[0]) {
+            GPIO.out_w1ts = gpioSet[0];
+        }
+        if (gpioClear[0]) {
+            GPIO.out_w1tc = gpioClear[0];
+        }
+        if (gpioSet[1]) {
+            GPIO.out1_w1ts.val = gpioSet[1];
+        }
+        if (gpioClear[1]) {
+            GPIO.out1_w1tc.val = gpioClear[1];
+        }
+        if (i2soSet | i2soClear) {
+            i2s_out_write_masks(i2soSet, i2soClear);
+        }
+    }
+#else
+    // There are no set/clear registers on the host, so the masks are
+    // expanded back into individual pin writes.
+    void PortMasks::write() const {
+        for (int word = 0; word < 2; ++word) {
+            for (int bit = 0; bit < 32; ++bit) {
+                uint32_t mask = uint32_t(1) << bit;
+                if (gpioSet[word] & mask) {
+                    __digitalWrite(pinnum_t(word * 32 + bit), 1);
+                }
+                if (gpioClear[word] & mask) {
+                    __digitalWrite(pinnum_t(word * 32 + bit), 0);
+                }
+            }
+        }
+    }
+#endif
+
+    bool PinSet::add(const Pin& pin) {
+        if (pin.undefined()) {
+            return true;  // Nothing to drive
+        }
+        return pin._detail->addToMasks(_on, _off);
+    }
+
+    void PinSet::clear() {
+        _on  = PortMasks();
+        _off = PortMasks();
+    }
+}
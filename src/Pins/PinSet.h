@@ -0,0 +1,59 @@
+// Copyright (c) 2021 -  FluidNC contributors
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#pragma once
+
+#include <esp_attr.h>  // IRAM_ATTR
+#include <cstdint>
+
+class Pin;
+
+namespace Pins {
+    // Register-level masks for a group of output pins.  GPIO pins map onto
+    // the ESP32 write-1-to-set / write-1-to-clear registers (word 0 for
+    // GPIO 0..31, word 1 for GPIO 32..39) and I2SO pins onto the expanded
+    // port data word, so a whole group can be updated with a single write
+    // per register instead of one virtual PinDetail::write() per pin.
+    struct PortMasks {
+        uint32_t gpioSet[2]   = { 0, 0 };
+        uint32_t gpioClear[2] = { 0, 0 };
+        uint32_t i2soSet      = 0;
+        uint32_t i2soClear    = 0;
+
+        inline PortMasks& operator|=(const PortMasks& o) {
+            gpioSet[0] |= o.gpioSet[0];
+            gpioSet[1] |= o.gpioSet[1];
+            gpioClear[0] |= o.gpioClear[0];
+            gpioClear[1] |= o.gpioClear[1];
+            i2soSet |= o.i2soSet;
+            i2soClear |= o.i2soClear;
+            return *this;
+        }
+
+        inline bool empty() const {
+            return !(gpioSet[0] | gpioSet[1] | gpioClear[0] | gpioClear[1] | i2soSet | i2soClear);
+        }
+
+        void write() const;
+    };
+
+    // A PinSet collects pins that are switched together and precomputes the
+    // masks for driving all of them to their active (on) or inactive (off)
+    // level, taking each pin's :low attribute into account.  Only pin types
+    // that can be expressed as masks can be added; for others add() returns
+    // false and the caller must keep using Pin::write().
+    class PinSet {
+        PortMasks _on;
+        PortMasks _off;
+
+    public:
+        PinSet() = default;
+
+        bool add(const Pin& pin);
+        void clear();
+
+        inline const PortMasks& on() const { return _on; }
+        inline const PortMasks& off() const { return _off; }
+        inline const PortMasks& value(bool high) const { return high ? _on : _off; }
+    };
+}
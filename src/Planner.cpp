@@ -11,6 +11,7 @@
 #include "Planner.h"
 
 #include "Machine/MachineConfig.h"
+#include "Trace.h"
 
 #include <stdlib.h>  // PSoc Required for labs
 
@@ -203,6 +204,7 @@ void plan_discard_current_block() {
             block_buffer_planned = block_index;
         }
         block_buffer_tail = block_index;
+        TRACE(PlannerPop, plan_get_block_buffer_count(), 0);
     }
 }
 
@@ -403,6 +405,7 @@ bool plan_buffer_line(float* target, plan_line_data_t* pl_data) {
         next_buffer_head  = plan_next_block_index(block_buffer_head);
         // Finish up by recalculating the plan with the new block.
         planner_recalculate();
+        TRACE(PlannerPush, plan_get_block_buffer_count(), block->line_number);
     }
     return true;
 }
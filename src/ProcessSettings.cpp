@@ -21,6 +21,8 @@
 #include "Uart.h"                 // Uart0.write()
 #include "FileStream.h"           // FileStream()
 #include "xmodem.h"               // xmodemReceive(), xmodemTransmit()
+#include "Trace.h"                // Trace::dump()
+#include "Spindles/VFDSpindle.h"   // VFD::sendRaw()
 
 #include <cstring>
 #include <map>
@@ -480,6 +482,7 @@ static Error xmodem_receive(const char* value, WebUI::AuthenticationLevel auth_l
         return Error::UploadFailed;
     }
     log_info("Receiving " << value << " via XModem");
+    flush_client_output(Uart0);
     int size = xmodemReceive(&Uart0, outfile);
     delete outfile;
     if (size >= 0) {
@@ -502,6 +505,7 @@ static Error xmodem_send(const char* value, WebUI::AuthenticationLevel auth_leve
         return Error::DownloadFailed;
     }
     log_info("Sending " << value << " via XModem");
+    flush_client_output(Uart0);
     int size = xmodemTransmit(&Uart0, infile);
     delete infile;
     if (size >= 0) {
@@ -538,6 +542,139 @@ static Error dump_config(const char* value, WebUI::AuthenticationLevel auth_leve
     return Error::Ok;
 }
 
+static Error set_telemetry(const char* value, WebUI::AuthenticationLevel auth_level, Print& out) {
+    InputClient* client = find_client(out);
+    if (!client) {
+        return Error::InvalidStatement;
+    }
+    if (!value) {
+        out << "$Report/Telemetry=" << client->_telemetryMs << '\n';
+        return Error::Ok;
+    }
+    char*    end;
+    uint32_t ms = strtoul(value, &end, 10);
+    if (*end || (ms && ms < 10)) {
+        return Error::InvalidValue;
+    }
+    client->_telemetryMs   = ms;
+    client->_lastTelemetry = 0;
+    return Error::Ok;
+}
+
+static Error set_status_push(const char* value, WebUI::AuthenticationLevel auth_level, Print& out) {
+    InputClient* client = find_client(out);
+    if (!client) {
+        return Error::InvalidStatement;
+    }
+    if (!value) {
+        out << "$Report/Status=" << client->_statusMs << (client->_statusChangedOnly ? ",changed" : "") << '\n';
+        return Error::Ok;
+    }
+    char*    end;
+    uint32_t ms          = strtoul(value, &end, 10);
+    bool     changedOnly = false;
+    if (*end == ',') {
+        if (strcasecmp(end + 1, "changed")) {
+            return Error::InvalidValue;
+        }
+        changedOnly = true;
+    } else if (*end) {
+        return Error::InvalidValue;
+    }
+    if (ms && ms < 10) {
+        return Error::InvalidValue;
+    }
+    client->_statusMs          = ms;
+    client->_statusChangedOnly = changedOnly;
+    client->_lastStatusCheck   = 0;
+    client->_lastStatusSent    = 0;
+    client->_statusSignature   = 0;
+    return Error::Ok;
+}
+
+#ifdef ENABLE_TRACE
+// $Trace/Dump sends the trace ring to the client as hex lines between data markers.
+// $Trace/Dump=<file> writes it in binary to a file, which $Xmodem/Send can fetch.
+static Error dump_trace(const char* value, WebUI::AuthenticationLevel auth_level, Print& out) {
+    if (!value || !*value) {
+        out << dataBeginMarker;
+        Trace::dump(out, true);
+        out << dataEndMarker;
+        return Error::Ok;
+    }
+    Print* outfile;
+    try {
+        outfile = new FileStream(value, "w");
+    } catch (...) {
+        log_info("Cannot open " << value);
+        return Error::UploadFailed;
+    }
+    Trace::dump(*outfile, false);
+    delete outfile;
+    log_info("Trace written to " << value);
+    return Error::Ok;
+}
+
+static Error clear_trace(const char* value, WebUI::AuthenticationLevel auth_level, Print& out) {
+    Trace::clear();
+    return Error::Ok;
+}
+#endif
+
+static Error show_client_stats(const char* value, WebUI::AuthenticationLevel auth_level, Print& out) {
+    int i = 0;
+    for (auto client : clientq) {
+        out << "[MSG:Client " << i++;
+        if (client->_queue) {
+            auto q = client->_queue;
+            out << " sent:" << q->_sentBytes.load() << " dropped:" << q->_dropped.load() << " stalls:" << q->_stalls.load()
+                << " highwater:" << q->_highWater << "/" << OutputQueue::depth;
+        } else {
+            out << " direct";
+        }
+        out << "]\n";
+    }
+    out << "[MSG:Chunks free:" << OutputChunk::available() << "/" << OutputChunk::poolSize << " broadcast dropped:" << allClients._dropped
+        << "]\n";
+    return Error::Ok;
+}
+
+static Error show_loop_stats(const char* value, WebUI::AuthenticationLevel auth_level, Print& out) {
+    out << "[MSG:Longest main loop iteration " << pollGapMaxUs[0] << "us web idle, " << pollGapMaxUs[1] << "us web busy]\n";
+    if (value && *value) {
+        reset_poll_stats();
+    }
+    return Error::Ok;
+}
+
+// Sends a Modbus request to the VFD, e.g. $VFD/Send=03 00 00 00 02 to read
+// two holding registers.  The bytes are the function code and data in hex;
+// the VFD task adds the address and CRC and logs the response.
+static Error vfd_send(const char* value, WebUI::AuthenticationLevel auth_level, Print& out) {
+    if (!value || !*value) {
+        return Error::InvalidValue;
+    }
+    uint8_t msg[16];
+    size_t  len = 0;
+    while (*value) {
+        char* end;
+        long  byte = strtol(value, &end, 16);
+        if (end == value || byte < 0 || byte > 0xff || len == sizeof(msg)) {
+            return Error::InvalidValue;
+        }
+        msg[len++] = byte;
+        value      = end;
+        while (*value == ' ' || *value == ',') {
+            ++value;
+        }
+    }
+    if (!Spindles::VFD::sendRaw(msg, len)) {
+        log_error("No VFD spindle, request too long, or VFD queue full");
+        return Error::InvalidValue;
+    }
+    return Error::Ok;
+}
+
 static Error fakeLaserMode(const char* value, WebUI::AuthenticationLevel auth_level, Print& out) {
     if (!value) {
         out << "$32=" << (spindle->isRateAdjusted() ? "1" : "0") << '\n';
@@ -556,6 +693,15 @@ void make_user_commands() {
     new UserCommand("CD", "Config/Dump", dump_config, anyState);
     new UserCommand("", "Help", show_help, anyState);
     new UserCommand("T", "State", showState, anyState);
+    new UserCommand("TM", "Report/Telemetry", set_telemetry, anyState);
+    new UserCommand("RS", "Report/Status", set_status_push, anyState);
+    new UserCommand("CS", "Clients/Stats", show_client_stats, anyState);
+    new UserCommand("LS", "Loop/Stats", show_loop_stats, anyState);
+    new UserCommand("VS", "VFD/Send", vfd_send, anyState);
+#ifdef ENABLE_TRACE
+    new UserCommand("TD", "Trace/Dump", dump_trace, anyState);
+    new UserCommand("TC", "Trace/Clear", clear_trace, anyState);
+#endif
     new UserCommand("J", "Jog", doJog, notIdleOrJog);
 
     new UserCommand("$", "GrblSettings/List", report_normal_settings, cycleOrHold);
@@ -20,6 +20,7 @@
 #include "Planner.h"        // plan_get_current_block
 #include "MotionControl.h"  // PARKING_MOTION_LINE_NUMBER
 #include "Settings.h"       // settings_execute_startup
+#include "Trace.h"          // TRACE
 
 #ifdef DEBUG_REPORT_REALTIME
 volatile bool rtExecDebug;
@@ -273,6 +274,9 @@ static void alarm_msg(ExecAlarm alarm_code) {
 // machine that controls the various real-time features.
 // NOTE: Do not alter this unless you know exactly what you are doing!
 static void protocol_do_alarm() {
+    if (rtAlarm != ExecAlarm::None) {
+        TRACE(Alarm, uint16_t(rtAlarm), 0);
+    }
     switch (rtAlarm) {
         case ExecAlarm::None:
             return;
@@ -735,6 +739,14 @@ void protocol_do_macro(int macro_num) {
 }
 
 void protocol_exec_rt_system() {
+#ifdef ENABLE_TRACE
+    // sys.state is assigned in many places, so transitions are picked up here
+    static State tracedState = State::Idle;
+    if (sys.state != tracedState) {
+        TRACE(StateChange, uint16_t(sys.state), uint32_t(tracedState));
+        tracedState = sys.state;
+    }
+#endif
 
     // call pollClients() to allow processing of realtime commands
     pollClients(true);
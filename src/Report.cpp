@@ -31,12 +31,14 @@
 #include "WebUI/TelnetServer.h"          // WebUI::telnet_server
 #include "WebUI/BTConfig.h"              // bt_config
 #include "WebUI/WebSettings.h"
+#include "ReportBuffer.h"
 
 #include <map>
 #include <freertos/task.h>
 #include <cstring>
 #include <cstdio>
 #include <cstdarg>
+#include <cmath>
 
 #ifdef DEBUG_REPORT_HEAP
 EspClass esp;
@@ -80,8 +82,13 @@ void _notifyf(const char* title, const char* format, ...) {
 Counter report_ovr_counter = 0;
 Counter report_wco_counter = 0;
 
-static const int coordStringLen = 20;
-static const int axesStringLen  = coordStringLen * MAX_N_AXIS;
+static const int coordStringLen   = 20;
+static const int statusReportSize = 512;
+static const int axesStringLen    = coordStringLen * MAX_N_AXIS;
+
+// Pushed status reports, see report_status_subscriptions()
+static const float    statusPositionEpsilon = 0.001f;  // mm
+static const uint32_t statusKeepaliveMs     = 1000;
 
 // formats axis values into a string and returns that string in rpt
 // NOTE: rpt should have at least size: axesStringLen
@@ -528,11 +535,10 @@ const char* state_name() {
     return "";
 }
 
-String pinString() {
-    String pins = "";
-
+// Appends the letters of the active probe, limit and control pins
+static void report_pins(ReportBuffer& pins) {
     if (config->_probe->get_state()) {
-        pins += 'P';
+        pins << 'P';
     }
 
     MotorMask lim_pin_state = limits_get_state();
@@ -540,13 +546,29 @@ String pinString() {
         auto n_axis = config->_axes->_numberAxis;
         for (int i = 0; i < n_axis; i++) {
             if (bitnum_is_true(lim_pin_state, i) || bitnum_is_true(lim_pin_state, i + 16)) {
-                pins += config->_axes->axisName(i);
+                pins << config->_axes->axisName(i);
             }
         }
     }
 
-    pins += config->_control->report();
-    return pins;
+    config->_control->report(pins);
+}
+
+// Allocation-free version of report_util_axis_values() for the realtime status report
+static void report_util_axis_values(const float* axis_value, ReportBuffer& rpt) {
+    float unit_conv = 1.0;  // unit conversion multiplier..default is mm
+    int   decimals  = 3;    // Default - report mm to 3 decimal places
+    if (config->_reportInches) {
+        unit_conv = 1.0f / MM_PER_INCH;
+        decimals  = 4;  // Report inches to 4 decimal places
+    }
+    auto n_axis = config->_axes->_numberAxis;
+    for (size_t idx = 0; idx < n_axis; idx++) {
+        rpt.fixed(axis_value[idx] * unit_conv, decimals);
+        if (idx < (n_axis - 1)) {
+            rpt << ',';
+        }
+    }
 }
 
 // Prints real-time data. This function grabs a real-time snapshot of the stepper subprogram
@@ -554,26 +576,27 @@ String pinString() {
 // specific needs, but the desired real-time data report must be as short as possible. This is
 // requires as it minimizes the computational overhead to keep running smoothly,
 // especially during g-code programs with fast, short line segments and high frequency reports (5-20Hz).
-void report_realtime_status(Print& client) {
-    client << "<" << state_name();
+//
+// GUIs poll this at a high rate on several clients at once, so the report is formatted
+// into a stack buffer without any heap allocation and sent with a single write().
+//
+// The |Bf: field is the only part that differs between clients, so it is left out here
+// and the offset where it belongs is returned; see send_realtime_status().
+static size_t format_realtime_status(ReportBuffer& rpt) {
+    rpt << "<" << state_name();
 
     // Report position
     float* print_position = get_mpos();
     if (bits_are_true(status_mask->get(), RtStatus::Position)) {
-        client << "|MPos:";
+        rpt << "|MPos:";
     } else {
-        client << "|WPos:";
+        rpt << "|WPos:";
         mpos_to_wpos(print_position);
     }
-    client << report_util_axis_values(print_position);
+    report_util_axis_values(print_position, rpt);
 
-    // Returns planner and serial read buffer states.
-#if 0
-    // XXX WMB problem with client_get_rx_buffer_available(client)
-    if (bits_are_true(status_mask->get(), RtStatus::Buffer)) {
-        client << "|Bf:" << plan_get_block_buffer_available() << "," << client_get_rx_buffer_available(client /* CLIENT_SERIAL ??? */);
-    }
-#endif
+    // Planner and serial read buffer states are added by send_realtime_status()
+    size_t bfOffset = rpt.length();
 
     if (config->_useLineNumbers) {
         // Report current line number
@@ -581,7 +604,7 @@ void report_realtime_status(Print& client) {
         if (cur_block != NULL) {
             uint32_t ln = cur_block->line_number;
             if (ln > 0) {
-                client << "|Ln:" << ln;
+                rpt << "|Ln:" << ln;
             }
         }
     }
@@ -592,11 +615,13 @@ void report_realtime_status(Print& client) {
         rate /= MM_PER_INCH;
     }
     // XXX WMB rate %.0f
-    client << "|FS:" << rate << "," << sys.spindle_speed;
+    rpt << "|FS:" << rate << "," << sys.spindle_speed;
 
-    String pins = pinString();
+    char         pinBuf[MAX_N_AXIS + 12];
+    ReportBuffer pins(pinBuf, sizeof(pinBuf));
+    report_pins(pins);
     if (pins.length()) {
-        client << "|Pn:" << pins;
+        rpt << "|Pn:" << pins.data();
     }
 
     if (report_wco_counter > 0) {
@@ -616,7 +641,8 @@ void report_realtime_status(Print& client) {
         if (report_ovr_counter == 0) {
             report_ovr_counter = 1;  // Set override on next report.
         }
-        client << "|WCO:" << report_util_axis_values(get_wco());
+        rpt << "|WCO:";
+        report_util_axis_values(get_wco(), rpt);
     }
 
     if (report_ovr_counter > 0) {
@@ -634,19 +660,19 @@ void report_realtime_status(Print& client) {
                 break;
         }
 
-        client << "|Ov:" << sys.f_override << "," << sys.r_override << "," << sys.spindle_speed_ovr;
+        rpt << "|Ov:" << sys.f_override << "," << sys.r_override << "," << sys.spindle_speed_ovr;
         SpindleState sp_state      = spindle->get_state();
         CoolantState coolant_state = config->_coolant->get_state();
         if (sp_state != SpindleState::Disable || coolant_state.Mist || coolant_state.Flood) {
-            client << "|A:";
+            rpt << "|A:";
             switch (sp_state) {
                 case SpindleState::Disable:
                     break;
                 case SpindleState::Cw:
-                    client << "S";
+                    rpt << "S";
                     break;
                 case SpindleState::Ccw:
-                    client << "C";
+                    rpt << "C";
                     break;
                 case SpindleState::Unknown:
                     break;
@@ -655,31 +681,182 @@ void report_realtime_status(Print& client) {
             auto coolant = coolant_state;
             // XXX WMB why .Flood in one case and ->hasMist() in the other? also see above
             if (coolant.Flood) {
-                client << "F";
+                rpt << "F";
             }
             if (config->_coolant->hasMist()) {
-                client << "M";
+                rpt << "M";
             }
         }
     }
     if (config->_sdCard->get_state() == SDState::BusyPrinting) {
         // XXX WMB FORMAT 4.2f
-        client << "|SD:" << config->_sdCard->percent_complete() << "," << config->_sdCard->filename();
+        rpt << "|SD:" << config->_sdCard->percent_complete() << "," << config->_sdCard->filename();
     }
 #ifdef DEBUG_STEPPER_ISR
-    client << "|ISRs:" << Stepper::isr_count;
+    rpt << "|ISRs:" << Stepper::isr_count;
 #endif
 #ifdef DEBUG_REPORT_HEAP
-    client << "|Heap:" << esp.getHeapSize();
+    rpt << "|Heap:" << esp.getHeapSize();
 #endif
-    client << ">\n";
+    rpt << ">\n";
+
+    if (rpt.overflowed()) {
+        // Never send a report without its terminator
+        rpt.clear();
+        rpt << "<" << state_name();
+        bfOffset = rpt.length();
+        rpt << ">\n";
+    }
+    return bfOffset;
+}
+
+// Sends a report from format_realtime_status() to client with a single write(),
+// splicing in the client's own planner and serial read buffer states.
+static void send_realtime_status(Print& client, const ReportBuffer& rpt, size_t bfOffset) {
+    if (bits_are_true(status_mask->get(), RtStatus::Buffer)) {
+        char         buf[statusReportSize];
+        ReportBuffer out(buf, sizeof(buf));
+        out.append(rpt.data(), bfOffset);
+        out << "|Bf:" << int(plan_get_block_buffer_available()) << "," << client_get_rx_buffer_available(client);
+        out.append(rpt.data() + bfOffset, rpt.length() - bfOffset);
+        if (!out.overflowed()) {
+            client.write(reinterpret_cast<const uint8_t*>(out.data()), out.length());
+            return;
+        }
+    }
+    client.write(reinterpret_cast<const uint8_t*>(rpt.data()), rpt.length());
+}
+
+void report_realtime_status(Print& client) {
+    char         buf[statusReportSize];
+    ReportBuffer rpt(buf, sizeof(buf));
+
+    size_t bfOffset = format_realtime_status(rpt);
+    send_realtime_status(client, rpt, bfOffset);
+}
+
+// Summarizes the fields that a changes-only status subscriber cares about:
+// state, position to within statusPositionEpsilon, overrides, spindle,
+// coolant and pins.  Equal signatures mean the report has not changed
+// enough to be worth sending.
+static uint32_t status_signature() {
+    uint32_t hash = 2166136261u;  // FNV-1a
+    auto     mix  = [&hash](uint32_t v) {
+        for (int i = 0; i < 4; i++) {
+            hash ^= (v & 0xff);
+            hash *= 16777619u;
+            v >>= 8;
+        }
+    };
+
+    mix(uint32_t(sys.state));
+
+    float* mpos   = get_mpos();
+    auto   n_axis = config->_axes->_numberAxis;
+    for (size_t idx = 0; idx < n_axis; idx++) {
+        mix(uint32_t(int32_t(lroundf(mpos[idx] / statusPositionEpsilon))));
+    }
+
+    mix(sys.f_override | (sys.r_override << 8) | (sys.spindle_speed_ovr << 16));
+    mix(sys.spindle_speed);
+    mix(uint32_t(spindle->get_state()));
+
+    CoolantState coolant = config->_coolant->get_state();
+    mix(coolant.Flood | (coolant.Mist << 1));
+
+    char         pinBuf[MAX_N_AXIS + 12];
+    ReportBuffer pins(pinBuf, sizeof(pinBuf));
+    report_pins(pins);
+    for (const char* p = pins.data(); *p; p++) {
+        mix(uint8_t(*p));
+    }
+    return hash;
+}
+
+void report_status_subscriptions() {
+    uint32_t now = millis();
+
+    // The report is formatted at most once per call and shared by all
+    // subscribers that are due, no matter how many there are.
+    char         buf[statusReportSize];
+    ReportBuffer rpt(buf, sizeof(buf));
+    size_t       bfOffset      = 0;
+    bool         formatted     = false;
+    bool         haveSignature = false;
+    uint32_t     signature     = 0;
+
+    for (auto client : clientq) {
+        if (!client->_statusMs || (now - client->_lastStatusCheck) < client->_statusMs) {
+            continue;
+        }
+        client->_lastStatusCheck = now;
+
+        if (client->_statusChangedOnly) {
+            if (!haveSignature) {
+                signature     = status_signature();
+                haveSignature = true;
+            }
+            // Unchanged reports are still sent now and then so the sender can
+            // tell a quiet machine from a lost connection.
+            if (signature == client->_statusSignature && (now - client->_lastStatusSent) < statusKeepaliveMs) {
+                continue;
+            }
+            client->_statusSignature = signature;
+        }
+        client->_lastStatusSent = now;
+
+        if (!formatted) {
+            bfOffset  = format_realtime_status(rpt);
+            formatted = true;
+        }
+        send_realtime_status(*client->_out, rpt, bfOffset);
+    }
+}
+
+void report_telemetry_frame(Print& client) {
+    TelemetryFrame frame;
+    frame.sync[0] = TelemetryFrame::sync0;
+    frame.sync[1] = TelemetryFrame::sync1;
+    frame.length  = sizeof(frame);
+    frame.state   = uint8_t(sys.state);
+    frame.millis  = millis();
+
+    float* mpos = get_mpos();
+    for (int axis = 0; axis < MAX_N_AXIS; axis++) {
+        frame.mpos[axis] = axis < config->_axes->_numberAxis ? mpos[axis] : 0.0f;
+    }
+    frame.feedRate         = Stepper::get_realtime_rate();
+    frame.spindleSpeed     = sys.spindle_speed;
+    frame.plannerAvailable = plan_get_block_buffer_available();
+    frame.plannerCount     = plan_get_block_buffer_count();
+    frame.rxAvailable      = client_get_rx_buffer_available(client);
+
+    uint8_t  checksum = 0;
+    uint8_t* bytes    = reinterpret_cast<uint8_t*>(&frame);
+    for (size_t i = 0; i < sizeof(frame) - 1; i++) {
+        checksum ^= bytes[i];
+    }
+    frame.checksum = checksum;
+
+    client.write(bytes, sizeof(frame));
+    client.flush();  // Frames have no line ending to push them out of an output queue
+}
+
+void report_telemetry() {
+    uint32_t now = millis();
+    for (auto client : clientq) {
+        if (client->_telemetryMs && (now - client->_lastTelemetry) >= client->_telemetryMs) {
+            client->_lastTelemetry = now;
+            report_telemetry_frame(*client->_out);
+        }
+    }
 }
 
-void hex_msg(uint8_t* buf, const char* prefix, int len) {
+void hex_msg(const uint8_t* buf, const char* prefix, int len) {
     char report[200];
     char temp[20];
-    sprintf(report, "%s", prefix);
-    for (int i = 0; i < len; i++) {
+    snprintf(report, sizeof(report), "%s", prefix);
+    for (int i = 0; i < len && strlen(report) + 6 < sizeof(report); i++) {
         sprintf(temp, " 0x%02X", buf[i]);
         strcat(report, temp);
     }
@@ -79,6 +79,38 @@ void report_echo_line_received(char* line, Print& client);
 // Prints realtime status report
 void report_realtime_status(Print& client);
 
+// Binary telemetry frame for senders that want high-rate position and
+// buffer information without parsing ASCII status reports.  A client
+// subscribes with $Report/Telemetry=<ms>; the frame is little-endian
+// and packed, and the checksum is the XOR of all preceding bytes.
+struct __attribute__((packed)) TelemetryFrame {
+    static const uint8_t sync0 = 0xA5;
+    static const uint8_t sync1 = 0x5A;
+
+    uint8_t  sync[2];
+    uint8_t  length;  // sizeof(TelemetryFrame)
+    uint8_t  state;   // State enum value
+    uint32_t millis;
+    float    mpos[MAX_N_AXIS];
+    float    feedRate;
+    uint32_t spindleSpeed;
+    uint8_t  plannerAvailable;
+    uint8_t  plannerCount;
+    uint16_t rxAvailable;
+    uint8_t  checksum;
+};
+
+void report_telemetry_frame(Print& client);
+
+// Pushes telemetry frames to subscribed clients whose interval has elapsed
+void report_telemetry();
+
+// Pushes realtime status reports to clients that subscribed with
+// $Report/Status=<ms> instead of polling with '?'.  With
+// $Report/Status=<ms>,changed a report is only pushed when the state,
+// position, overrides, spindle, coolant or pins have changed.
+void report_status_subscriptions();
+
 // Prints recorded probe position
 void report_probe_parameters(Print& client);
 
@@ -97,7 +129,7 @@ void report_realtime_debug();
 
 void reportTaskStackSize(UBaseType_t& saved);
 
-void hex_msg(uint8_t* buf, const char* prefix, int len);
+void hex_msg(const uint8_t* buf, const char* prefix, int len);
 
 void addPinReport(char* status, char pinLetter);
 
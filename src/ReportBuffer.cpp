@@ -0,0 +1,139 @@
+// Copyright (c) 2021 -  FluidNC contributors
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#include "ReportBuffer.h"
+
+#include <cmath>
+#include <cstring>
+
+static const uint32_t powersOf10[] = { 1, 10, 100, 1000, 10000, 100000, 1000000 };
+
+// Writes the decimal digits of v, returns the number of characters
+static size_t format_uint(char* buf, uint32_t v) {
+    char   tmp[10];
+    size_t n = 0;
+    do {
+        tmp[n++] = char('0' + v % 10);
+        v /= 10;
+    } while (v);
+    for (size_t i = 0; i < n; i++) {
+        buf[i] = tmp[n - 1 - i];
+    }
+    return n;
+}
+
+size_t format_fixed(char* buf, float v, int decimals) {
+    if (decimals < 0) {
+        decimals = 0;
+    } else if (decimals > 6) {
+        decimals = 6;
+    }
+
+    if (std::isnan(v)) {
+        strcpy(buf, "nan");
+        return 3;
+    }
+
+    bool negative = v < 0.0f;
+    if (negative) {
+        v = -v;
+    }
+    if (v >= 4294967040.0f) {  // Same limit as Print::printFloat()
+        strcpy(buf, "ovf");
+        return 3;
+    }
+
+    // Split first so that the integer part never overflows the
+    // scaling, then round the fraction and carry into the integer.
+    uint32_t scale = powersOf10[decimals];
+    uint32_t ipart = uint32_t(v);
+    uint32_t frac  = uint32_t((v - float(ipart)) * float(scale) + 0.5f);
+    if (frac >= scale) {
+        ipart++;
+        frac -= scale;
+    }
+
+    size_t n = 0;
+    if (negative && (ipart || frac)) {
+        buf[n++] = '-';
+    }
+    n += format_uint(buf + n, ipart);
+    if (decimals) {
+        buf[n++] = '.';
+        for (int i = decimals - 1; i >= 0; i--) {
+            buf[n + i] = char('0' + frac % 10);
+            frac /= 10;
+        }
+        n += decimals;
+    }
+    buf[n] = '\0';
+    return n;
+}
+
+char* ReportBuffer::reserve(size_t n) {
+    // Keep one byte for a terminating NUL so data() is always a C string
+    if (_length + n >= _capacity) {
+        _overflow = true;
+        return nullptr;
+    }
+    char* p = _buf + _length;
+    _length += n;
+    p[n] = '\0';
+    return p;
+}
+
+ReportBuffer& ReportBuffer::operator<<(char c) {
+    char* p = reserve(1);
+    if (p) {
+        *p = c;
+    }
+    return *this;
+}
+
+ReportBuffer& ReportBuffer::operator<<(const char* s) {
+    return append(s, strlen(s));
+}
+
+ReportBuffer& ReportBuffer::append(const char* s, size_t n) {
+    char* p = reserve(n);
+    if (p) {
+        memcpy(p, s, n);
+    }
+    return *this;
+}
+
+ReportBuffer& ReportBuffer::operator<<(int v) {
+    char   tmp[12];
+    size_t n = 0;
+    if (v < 0) {
+        tmp[n++] = '-';
+        n += format_uint(tmp + n, 0u - uint32_t(v));
+    } else {
+        n += format_uint(tmp + n, uint32_t(v));
+    }
+    char* p = reserve(n);
+    if (p) {
+        memcpy(p, tmp, n);
+    }
+    return *this;
+}
+
+ReportBuffer& ReportBuffer::operator<<(unsigned int v) {
+    char   tmp[10];
+    size_t n = format_uint(tmp, v);
+    char*  p = reserve(n);
+    if (p) {
+        memcpy(p, tmp, n);
+    }
+    return *this;
+}
+
+ReportBuffer& ReportBuffer::fixed(float v, int decimals) {
+    char   tmp[24];
+    size_t n = format_fixed(tmp, v, decimals);
+    char*  p = reserve(n);
+    if (p) {
+        memcpy(p, tmp, n);
+    }
+    return *this;
+}
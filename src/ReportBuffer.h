@@ -0,0 +1,63 @@
+// Copyright (c) 2021 -  FluidNC contributors
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// ReportBuffer formats text into caller-provided storage, typically a stack
+// array, so that frequently sent reports like the realtime status can be
+// assembled without String temporaries or heap allocations and then handed
+// to the client in a single write().  Output that does not fit is dropped
+// and overflowed() becomes true.
+//
+// The << operators mirror the ones in MyIOStream.h for Print, including
+// printing floats with 3 decimals, so report code reads the same.
+class ReportBuffer {
+    char*  _buf;
+    size_t _capacity;
+    size_t _length   = 0;
+    bool   _overflow = false;
+
+    char* reserve(size_t n);
+
+public:
+    ReportBuffer(char* buf, size_t capacity) : _buf(buf), _capacity(capacity) {
+        if (capacity) {
+            buf[0] = '\0';
+        }
+    }
+
+    ReportBuffer(const ReportBuffer&) = delete;
+    ReportBuffer& operator=(const ReportBuffer&) = delete;
+
+    ReportBuffer& operator<<(char c);
+    ReportBuffer& operator<<(const char* s);
+    ReportBuffer& operator<<(int v);
+    ReportBuffer& operator<<(unsigned int v);
+    ReportBuffer& operator<<(long v) { return *this << int(v); }
+    ReportBuffer& operator<<(unsigned long v) { return *this << (unsigned int)(v); }
+    ReportBuffer& operator<<(float v) { return fixed(v, 3); }
+
+    // Appends v rounded to the given number of decimals (0..6).
+    ReportBuffer& fixed(float v, int decimals);
+
+    // Appends n bytes from s, which need not be NUL-terminated.
+    ReportBuffer& append(const char* s, size_t n);
+
+    void clear() {
+        _length   = 0;
+        _overflow = false;
+    }
+
+    const char* data() const { return _buf; }
+    size_t      length() const { return _length; }
+    bool        overflowed() const { return _overflow; }
+};
+
+// Formats v with the given number of decimals into buf, which must have
+// room for at least 24 characters.  Returns the number of characters
+// written, not counting the terminating NUL.  This is much faster than
+// printf("%.*f") and never allocates.
+size_t format_fixed(char* buf, float v, int decimals);
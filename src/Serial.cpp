@@ -43,6 +43,7 @@
 #include "WebUI/InputBuffer.h"
 #include "WebUI/Commands.h"
 #include "WebUI/WifiServices.h"
+#include "WebUI/WebServer.h"  // run_commands()
 #include "MotionControl.h"
 #include "Report.h"
 #include "System.h"
@@ -222,20 +223,100 @@ InputClient* sdClient = new InputClient(nullptr);
 
 std::vector<InputClient*> clientq;
 
-void register_client(Stream* client_stream) {
-    clientq.push_back(new InputClient(client_stream));
+InputClient::InputClient(Stream* source, size_t rxCapacity, OutputPolicy policy, const char* name) :
+    _in(source), _out(source), _linelen(0), _line_num(0), _line_returned(false), _rxCapacity(rxCapacity) {
+    if (policy != OutputPolicy::Direct) {
+        _queue = new OutputQueue(source, policy, name);
+        _out   = _queue;
+    }
+}
+
+int InputClient::getc() {
+    if (_rxPos == _rxLen) {
+        if (!_transport) {
+            return _in ? _in->read() : -1;
+        }
+        _rxPos = 0;
+        _rxLen = _transport->read(_rx, readAhead);
+        if (_rxLen == 0) {
+            return -1;
+        }
+    }
+    return _rx[_rxPos++];
+}
+
+void register_client(Stream* client_stream, size_t rxCapacity, OutputPolicy policy, const char* name) {
+    clientq.push_back(new InputClient(client_stream, rxCapacity, policy, name));
+}
+void register_client(Transport* client_transport, size_t rxCapacity, OutputPolicy policy, const char* name) {
+    auto client        = new InputClient(client_transport, rxCapacity, policy, name);
+    client->_transport = client_transport;
+    clientq.push_back(client);
 }
 void client_init() {
-    register_client(&Uart0);               // USB Serial
-    register_client(&WebUI::inputBuffer);  // Macros
+    allClients.begin();
+    register_client(&Uart0, Uart::rxBufferSize, OutputPolicy::Block, "uart0Out");  // USB Serial
+    register_client(&WebUI::inputBuffer, WebUI::InputBuffer::RXBUFFERSIZE);      // Macros
 }
 
+int InputClient::rx_available() const {
+    int capacity = _rxCapacity ? int(_rxCapacity) : maxLine;
+    int avail    = capacity - _in->available() - (_rxLen - _rxPos);
+    return avail < 0 ? 0 : avail;
+}
+
+InputClient* find_client(Print& out) {
+    for (auto client : clientq) {
+        if (client->_out == &out || client->_in == &out) {
+            return client;
+        }
+    }
+    return nullptr;
+}
+
+int client_get_rx_buffer_available(Print& client) {
+    auto ic = find_client(client);
+    return ic ? ic->rx_available() : 0;
+}
 
 
+
+uint32_t pollGapMaxUs[2] = { 0, 0 };
+static uint32_t lastPollUs = 0;
+
+void reset_poll_stats() {
+    pollGapMaxUs[0] = pollGapMaxUs[1] = 0;
+    lastPollUs                        = 0;
+}
+
+// Records the time since the previous call, which is how long input and
+// realtime commands went unserviced.
+static void time_poll() {
+    uint32_t now = micros();
+    if (lastPollUs) {
+        uint32_t gap = now - lastPollUs;
+#ifdef ENABLE_WIFI
+        int web = WebUI::wifi_services.busy() ? 1 : 0;
+#else
+        int web = 0;
+#endif
+        if (gap > pollGapMaxUs[web]) {
+            pollGapMaxUs[web] = gap;
+        }
+    }
+    lastPollUs = now;
+}
+
 InputClient* pollClients(bool realtime_only /*=false*/) {
+    time_poll();
 
     auto sdcard = config->_sdCard;
 
+    // Binary telemetry and subscribed status reports are pushed from here
+    // because this is called frequently both from the main loop and during motion.
+    report_telemetry();
+    report_status_subscriptions();
+
     // realtime_only allows for calls that just handle realtime commands.
 
     if (realtime_only &&
@@ -245,17 +326,16 @@ InputClient* pollClients(bool realtime_only /*=false*/) {
         return NULL;
 
     for (auto client : clientq) {
-        auto source = client->_in;
-        int  c      = source->read();
-
-        if (c >= 0) {
+        // Work through whatever has arrived, up to the end of a line
+        int c;
+        while ((c = client->getc()) >= 0) {
             char ch = c;
             if (client->_line_returned) {
                 client->_line_returned = false;
                 client->_linelen       = 0;
             }
             if (is_realtime_command(c)) {
-                execute_realtime_command(static_cast<Cmd>(c), *source);
+                execute_realtime_command(static_cast<Cmd>(c), *client->_out);
                 continue;
             }
             if (realtime_only)
@@ -272,7 +352,7 @@ InputClient* pollClients(bool realtime_only /*=false*/) {
                 continue;
             }
             if ((client->_linelen + 1) == InputClient::maxLine) {
-                report_status_message(Error::Overflow, *source);
+                report_status_message(Error::Overflow, *client->_out);
                 // XXX could show a message with the overflow line
                 // XXX There is a problem here - the final fragment of the
                 // too-long line will be returned as a valid line.  We really
@@ -309,7 +389,7 @@ InputClient* pollClients(bool realtime_only /*=false*/) {
 
     WebUI::COMMANDS::handle();  // Handles feeding watchdog and ESP restart
 #ifdef ENABLE_WIFI
-    WebUI::wifi_services.handle();  // OTA, web_server, telnet_server polling
+    WebUI::web_server.run_commands();  // [ESP] commands from the web services task
 #endif
 
 
@@ -355,17 +435,88 @@ InputClient* pollClients(bool realtime_only /*=false*/) {
     return nullptr;
 }
 
-size_t AllClients::write(uint8_t data) {
+void flush_client_output(Print& out) {
+    logging_flush();
+    auto client = find_client(out);
+    if (client && client->_queue) {
+        client->_queue->waitEmpty(500 / portTICK_PERIOD_MS);
+    }
+}
+
+void AllClients::begin() {
+    OutputChunk::initPool();
+    _lock = xSemaphoreCreateMutex();
+}
+
+// Must be called with _lock held
+void AllClients::send(OutputChunk* chunk) {
     for (auto client : clientq) {
-        client->_out->write(data);
+        if (client->_queue) {
+            client->_queue->broadcast(chunk);
+        } else {
+            client->_out->write(reinterpret_cast<const uint8_t*>(chunk->data), chunk->len);
+        }
     }
-    return 1;
+    chunk->release();
+}
+
+size_t AllClients::write(uint8_t data) {
+    return write(&data, 1);
 }
 size_t AllClients::write(const uint8_t* buffer, size_t length) {
-    for (auto client : clientq) {
-        client->_out->write(buffer, length);
+    if (!_lock) {
+        // Before client_init()
+        for (auto client : clientq) {
+            client->_out->write(buffer, length);
+        }
+        return length;
     }
+
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    size_t done = 0;
+    while (done < length) {
+        if (!_stage) {
+            _stage = OutputChunk::allocate(OutputQueue::blockMs / portTICK_PERIOD_MS);
+            if (!_stage) {
+                // The pool is exhausted, so at least keep the Direct clients informed
+                ++_dropped;
+                for (auto client : clientq) {
+                    if (!client->_queue) {
+                        client->_out->write(buffer + done, length - done);
+                    }
+                }
+                break;
+            }
+        }
+        size_t n = length - done;
+        if (n > OutputChunk::capacity - _stage->len) {
+            n = OutputChunk::capacity - _stage->len;
+        }
+        memcpy(_stage->data + _stage->len, buffer + done, n);
+        _stage->len += n;
+        done += n;
+        if (_stage->len == OutputChunk::capacity) {
+            send(_stage);
+            _stage = nullptr;
+        }
+    }
+    if (_stage && _stage->len && _stage->data[_stage->len - 1] == '\n') {
+        send(_stage);
+        _stage = nullptr;
+    }
+    xSemaphoreGive(_lock);
     return length;
 }
+void AllClients::flush() {
+    if (!_lock) {
+        return;
+    }
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    if (_stage && _stage->len) {
+        send(_stage);
+        _stage = nullptr;
+    }
+    xSemaphoreGive(_lock);
+}
 
 AllClients allClients;
@@ -12,6 +12,8 @@
 #include <stdint.h>
 #include <Stream.h>
 #include "FluidTypes.h"
+#include "OutputQueue.h"
+#include "Transport.h"
 
 
 // See if the character is an action command like feedhold or jogging. If so, do the action and return true
@@ -36,26 +38,97 @@ bool is_realtime_command(uint8_t data);
 class InputClient {
 public:
     static const int maxLine = 255;
-    InputClient(Stream* source) : _in(source), _out(source), _linelen(0), _line_num(0), _line_returned(false) {}
+    static const int readAhead = 64;
+
+    InputClient(Stream* source, size_t rxCapacity = 0, OutputPolicy policy = OutputPolicy::Direct, const char* name = "client");
     Stream* _in;
-    Print*  _out;
+    Print*  _out;  // _queue when output is queued, else _in
     char    _line[maxLine];
     size_t  _linelen;
     int     _line_num;
     bool    _line_returned;
+
+    // Size of the transport's receive buffer, or 0 if it is not known.
+    size_t _rxCapacity;
+
+    // Set when _in supports bulk reads.  pollClients() then takes whatever
+    // has arrived into _rx in one call and works through it from there.
+    Transport* _transport = nullptr;
+    uint8_t    _rx[readAhead];
+    uint8_t    _rxPos = 0;
+    uint8_t    _rxLen = 0;
+
+    // The next received byte, or -1 if there is none
+    int getc();
+
+    // Output queue in front of _in's transmit side, or nullptr for OutputPolicy::Direct
+    OutputQueue* _queue = nullptr;
+
+    // Binary telemetry subscription; 0 means not subscribed.  See report_telemetry().
+    uint32_t _telemetryMs   = 0;
+    uint32_t _lastTelemetry = 0;
+
+    // Pushed status report subscription; 0 means not subscribed.  See report_status_subscriptions().
+    uint32_t _statusMs          = 0;
+    bool     _statusChangedOnly = false;
+    uint32_t _lastStatusCheck   = 0;
+    uint32_t _lastStatusSent    = 0;
+    uint32_t _statusSignature   = 0;
+
+    // Number of bytes a character-counting sender may still send without
+    // overrunning the receive buffer.  pollClients() moves at most one line
+    // per pass from the transport into _line, so the bytes that are still
+    // waiting in the transport or in _rx are what the sender has to count.
+    int rx_available() const;
 };
 
 InputClient* pollClients(bool realtime_only=false);
 
+// The longest time between pollClients() calls, in microseconds, while
+// the web services were idle [0] and busy [1].
+extern uint32_t pollGapMaxUs[2];
+void            reset_poll_stats();
+
+// Finds the client whose output goes to the given Print, or nullptr.
+InputClient* find_client(Print& out);
+
+// Free receive buffer space for the client that writes to the given Print,
+// as reported in the |Bf: status field.
+int client_get_rx_buffer_available(Print& client);
+
+// Broadcasts to every client.  Output is collected into a chunk that is
+// formatted once and, at the end of each line, placed by reference in the
+// output queue of every queued client; Direct clients are written to
+// synchronously.
 class AllClients : public Print {
 public:
     AllClients() = default;
     size_t write(uint8_t data) override;
     size_t write(const uint8_t* buffer, size_t length) override;
+    void   flush() override;
+
+    void begin();
+
+    // Broadcasts that could not get a chunk from the pool
+    uint32_t _dropped = 0;
+
+private:
+    SemaphoreHandle_t _lock  = nullptr;
+    OutputChunk*      _stage = nullptr;
+
+    void send(OutputChunk* chunk);
 };
 
-void register_client(Stream* client_stream);
+void register_client(Stream* client_stream, size_t rxCapacity = 0, OutputPolicy policy = OutputPolicy::Direct, const char* name = "client");
+void register_client(Transport* client_transport, size_t rxCapacity = 0, OutputPolicy policy = OutputPolicy::Direct, const char* name = "client");
+
+// Waits until queued output for the client that writes to out, including
+// pending log messages, has reached the transport.  Used before a transport
+// is taken over for a binary protocol like XModem.
+void flush_client_output(Print& out);
 
 void execute_realtime_command(Cmd command, Print& client);
 
 extern AllClients allClients;
+
+extern std::vector<InputClient*> clientq;
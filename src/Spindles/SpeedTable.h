@@ -0,0 +1,97 @@
+// Copyright (c) 2021 -  FluidNC contributors
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#pragma once
+
+#include "../SpindleDatatypes.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Spindles {
+    // The speed map compiled for lookup.  Spindle::mapSpeed() runs for every
+    // step segment in laser mode, and walking the speed map there costs
+    // time in proportion to the number of map entries.  The table divides
+    // the speed range into cells and records, for each cell, the segment
+    // that covers its start, so a lookup is one table read, usually no
+    // more than one comparison, and the same 16.16 fixed-point
+    // interpolation that setupSpeeds() prepared.  The segments are copied
+    // into the table so that it does not depend on the arena-allocated
+    // map, and it is a fixed size so it lives in DRAM with the spindle.
+    class SpeedTable {
+    public:
+        static const size_t maxEntries = 32;
+        static const size_t cells      = 256;
+
+        // Compiles a map whose entries have speed, offset and scale as
+        // setupSpeeds() leaves them.  Returns false, leaving the table
+        // unusable, if there are too few or too many entries or if the
+        // speeds decrease.
+        template <typename Map>
+        bool build(const Map& speeds) {
+            _ready = false;
+            size_t n = speeds.size();
+            if (n < 2 || n > maxEntries) {
+                return false;
+            }
+            for (size_t i = 0; i < n; i++) {
+                if (i && speeds[i].speed < speeds[i - 1].speed) {
+                    return false;
+                }
+                _entries[i] = { speeds[i].speed, speeds[i].offset, speeds[i].scale };
+            }
+            _segments = n - 1;
+
+            SpindleSpeed max = _entries[_segments].speed;
+            _shift           = 0;
+            while ((max >> _shift) >= cells) {
+                ++_shift;
+            }
+
+            // The segment that covers the start of each cell, found the
+            // same way Spindle::mapSpeed() walks the map
+            size_t seg = 0;
+            for (size_t c = 0; c < cells; c++) {
+                SpindleSpeed start = SpindleSpeed(c) << _shift;
+                while (seg < _segments && start >= _entries[seg + 1].speed) {
+                    ++seg;
+                }
+                _cell[c] = seg;
+            }
+            _ready = true;
+            return true;
+        }
+
+        bool ready() const { return _ready; }
+
+        // The device speed for speed, identical to walking the map
+        uint32_t map(SpindleSpeed speed) const {
+            if (speed == 0 || speed < _entries[0].speed) {
+                return _entries[0].offset;
+            }
+            if (speed >= _entries[_segments].speed) {
+                return _entries[_segments].offset;
+            }
+            // The speed is below the last entry, so the search ends on a
+            // segment before it
+            size_t i = _cell[speed >> _shift];
+            while (speed >= _entries[i + 1].speed) {
+                ++i;
+            }
+            return _entries[i].offset + (((speed - _entries[i].speed) * _entries[i].scale) >> 16);
+        }
+
+    private:
+        struct Entry {
+            SpindleSpeed speed;
+            uint32_t     offset;
+            uint32_t     scale;
+        };
+
+        Entry   _entries[maxEntries];
+        uint8_t _cell[cells];
+        size_t  _segments = 0;
+        uint8_t _shift    = 0;
+        bool    _ready    = false;
+    };
+}
@@ -7,6 +7,7 @@
 #include "Spindle.h"
 
 #include "../System.h"  //sys.spindle_speed_ovr
+#include "../Trace.h"
 #include <esp32-hal.h>  // delay()
 
 Spindles::Spindle* spindle = nullptr;
@@ -48,6 +49,7 @@ namespace Spindles {
     void Spindle::setupSpeeds(uint32_t max_dev_speed) {
         int nsegments = _speeds.size() - 1;
         if (nsegments < 1) {
+            _speedTable.build(_speeds);  // Marks it unusable
             return;
         }
         int i;
@@ -77,6 +79,10 @@ namespace Spindles {
         _speeds[i].offset = offset;
         scaler            = 0;
         _speeds[i].scale  = scaler;
+
+        if (!_speedTable.build(_speeds)) {
+            log_warn("Speed map cannot be tabulated; using the slower search");
+        }
     }
 
     void Spindle::afterParse() {}
@@ -101,6 +107,9 @@ namespace Spindles {
     uint32_t Spindle::mapSpeed(SpindleSpeed speed) {
         speed             = speed * sys.spindle_speed_ovr / 100;
         sys.spindle_speed = speed;
+        if (_speedTable.ready()) {
+            return _speedTable.map(speed);
+        }
         if (speed < _speeds[0].speed) {
             return _speeds[0].offset;
         }
@@ -129,71 +138,53 @@ namespace Spindles {
         // log_debug("rpm " << speed << " speed " << dev_speed); // This will spew quite a bit of data on your output
         return dev_speed;
     }
-    void Spindle::spindleDelay(SpindleState state, SpindleSpeed speed) {
-        uint32_t up = 0, down = 0;
-        switch (state) {
+    // Time for the spindle to get from its current state and speed to the
+    // new ones.  The spin-up and spin-down times are for the full speed
+    // range and the time for a change is in proportion to it.  A reversal
+    // spins down to a stop and up again.
+    uint32_t Spindle::rampMs(SpindleState state, SpindleSpeed speed) {
+        if (state == SpindleState::Unknown) {
+            // Unknown is only used for an initializer value,
+            // never as a new target state.
+            return 0;
+        }
+        SpindleSpeed from;
+        switch (_current_state) {
             case SpindleState::Unknown:
-                // Unknown is only used for an initializer value,
-                // never as a new target state.
+                from = maxSpeed();  // Assume the worst
                 break;
             case SpindleState::Disable:
-                switch (_current_state) {
-                    case SpindleState::Unknown:
-                        down = maxSpeed();
-                        break;
-                    case SpindleState::Disable:
-                        break;
-                    case SpindleState::Cw:
-                    case SpindleState::Ccw:
-                        down = _current_speed;
-                        break;
-                }
-            case SpindleState::Cw:
-                switch (_current_state) {
-                    case SpindleState::Unknown:
-                        down = maxSpeed();
-                        // fall through
-                    case SpindleState::Disable:
-                        up = speed;
-                        break;
-                    case SpindleState::Cw:
-                        if (speed > _current_speed) {
-                            up = speed - _current_speed;
-                        } else {
-                            down = speed - _current_speed;
-                        }
-                        break;
-                    case SpindleState::Ccw:
-                        down = _current_speed;
-                        up   = speed;
-                        break;
-                }
-            case SpindleState::Ccw:
-                switch (_current_state) {
-                    case SpindleState::Unknown:
-                        down = maxSpeed();
-                        // fall through
-                    case SpindleState::Disable:
-                        up = speed;
-                        break;
-                    case SpindleState::Cw:
-                        down = _current_speed;
-                        up   = speed;
-                        break;
-                    case SpindleState::Ccw:
-                        if (speed > _current_speed) {
-                            up = speed - _current_speed;
-                        } else {
-                            down = speed - _current_speed;
-                        }
-                        break;
-                }
+                from = 0;
+                break;
+            default:
+                from = _current_speed;
+                break;
         }
-        if (down) {
-            delay(_spindown_ms * down / maxSpeed());
+        SpindleSpeed to = state == SpindleState::Disable ? 0 : speed;
+
+        uint32_t up = 0, down = 0;
+        bool     reversing = _current_state != state && _current_state != SpindleState::Disable && state != SpindleState::Disable;
+        if (reversing) {
+            down = from;
+            up   = to;
+        } else if (to > from) {
+            up = to - from;
+        } else {
+            down = from - to;
         }
-        if (up) {
-            delay(_spinup_ms * up / maxSpeed());
+
+        uint32_t max = maxSpeed();
+        if (max == 0) {
+            return 0;
+        }
+        return uint32_t((uint64_t(_spinup_ms) * up + uint64_t(_spindown_ms) * down) / max);
+    }
+
+    void Spindle::spindleDelay(SpindleState state, SpindleSpeed speed) {
+        TRACE(Spindle, uint16_t(state), speed);
+        uint32_t ms = rampMs(state, speed);
+        if (ms) {
+            delay(ms);
         }
         _current_state = state;
         _current_speed = speed;
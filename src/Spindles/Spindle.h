@@ -6,6 +6,7 @@
 #include <cstdint>
 
 #include "../SpindleDatatypes.h"
+#include "SpeedTable.h"
 
 #include "../Configuration/Configurable.h"
 #include "../Configuration/GenericFactory.h"
@@ -37,6 +38,7 @@ namespace Spindles {
 
         static void switchSpindle(uint8_t new_tool, SpindleList spindles, Spindle*& spindle);
 
+        uint32_t     rampMs(SpindleState state, SpindleSpeed speed);
         void         spindleDelay(SpindleState state, SpindleSpeed speed);
         virtual void init() = 0;  // not in constructor because this also gets called when $$ settings change
 
@@ -56,14 +58,15 @@ namespace Spindles {
         volatile SpindleState _current_state = SpindleState::Unknown;
         volatile SpindleSpeed _current_speed = 0;
 
-        // scaler units are ms/rpm * 2^16.
-        // The computation is deltaRPM * scaler >> 16
+        // Times to spin up from a stop to maxSpeed() and back down.  Speed
+        // changes wait in proportion to the change; see rampMs().
         uint32_t _spinup_ms   = 0;
         uint32_t _spindown_ms = 0;
 
         int _tool = -1;
 
-        std::vector<Configuration::speedEntry> _speeds;
+        Configuration::SpeedMap _speeds;
+        SpeedTable              _speedTable;  // _speeds compiled by setupSpeeds()
 
         // Name is required for the configuration factory to work.
         virtual const char* name() const = 0;
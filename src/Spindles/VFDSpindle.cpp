@@ -29,23 +29,26 @@
 #include <freertos/queue.h>
 #include <atomic>
 
-const int        VFD_RS485_BUF_SIZE   = 127;
-const int        VFD_RS485_QUEUE_SIZE = 10;                                     // number of commands that can be queued up.
-const int        RESPONSE_WAIT_MS     = 1000;                                   // how long to wait for a response
-const int        VFD_RS485_POLL_RATE  = 250;                                    // in milliseconds between commands
-const TickType_t response_ticks       = RESPONSE_WAIT_MS / portTICK_PERIOD_MS;  // in milliseconds between commands
+const int        VFD_RS485_BUF_SIZE    = 127;
+const int        VFD_RS485_QUEUE_SIZE  = 10;                                     // number of commands that can be queued up.
+const int        RESPONSE_WAIT_MS      = 1000;                                   // how long to wait for a response
+const int        VFD_RS485_POLL_RATE   = 250;                                    // in milliseconds between status polls
+const int        VFD_RS485_SYNC_POLL   = 50;                                     // in milliseconds between polls while syncing speed
+const int        VFD_RS485_RETRY_DELAY = 50;                                     // in milliseconds before a retry
+const int        VFD_SYNC_LIMIT_MS     = 10000;                                  // give up when the speed does not change for this long
+const TickType_t response_ticks        = RESPONSE_WAIT_MS / portTICK_PERIOD_MS;  // in milliseconds between commands
 
 namespace Spindles {
     QueueHandle_t VFD::vfd_cmd_queue     = nullptr;
     TaskHandle_t  VFD::vfd_cmdTaskHandle = nullptr;
 
-    void VFD::reportParsingErrors(ModbusCommand cmd, uint8_t* rx_message, size_t read_length) {
+    void VFD::reportParsingErrors(const ModbusCommand& cmd, const uint8_t* rx_message, size_t read_length) {
 #ifdef DEBUG_VFD
         hex_msg(cmd.msg, "RS485 Tx: ", cmd.tx_length);
         hex_msg(rx_message, "RS485 Rx: ", read_length);
 #endif
     }
-    void VFD::reportCmdErrors(ModbusCommand cmd, uint8_t* rx_message, size_t read_length, uint8_t id) {
+    void VFD::reportCmdErrors(const ModbusCommand& cmd, const uint8_t* rx_message, size_t read_length, uint8_t id) {
 #ifdef DEBUG_VFD
         hex_msg(cmd.msg, "RS485 Tx: ", cmd.tx_length);
         hex_msg(rx_message, "RS485 Rx: ", read_length);
@@ -64,32 +67,94 @@ namespace Spindles {
 #endif
     }
 
-    // The communications task
+    // Sends a command and waits for its response, retrying on failure.  A
+    // preemptible transaction, a status poll, gives up between attempts when
+    // a command is waiting in the queue.
+    VFD::Outcome VFD::transact(const ModbusCommand& cmd, Modbus::FrameReceiver& rx, bool preemptible) {
+        auto&      uart     = *_uart;
+        uint32_t   gapUs    = Modbus::interFrameUs(uart.baud);
+        TickType_t gapTicks = gapUs / (1000 * portTICK_PERIOD_MS) + 1;
+
+        for (int retry_count = 0; retry_count < MAX_RETRIES; ++retry_count) {
+            if (retry_count) {
+                if (preemptible && uxQueueMessagesWaiting(vfd_cmd_queue)) {
+                    return Outcome::Preempted;
+                }
+                vTaskDelay(VFD_RS485_RETRY_DELAY / portTICK_PERIOD_MS);
+            }
+
+            // Flush the UART and write the data:
+            uart.flush();
+            uart.write(cmd.msg, cmd.tx_length);
+            uart.flushTxTimed(response_ticks);
+
+            // Read until the frame is complete.  Each read waits at most the
+            // inter-frame time, so a silent line ends the frame promptly.
+            rx.begin(_modbus_id, cmd.rx_length, RESPONSE_WAIT_MS * 1000, gapUs, micros());
+            while (rx.receiving()) {
+                uint8_t chunk[VFD_RS485_MAX_MSG_SIZE];
+                size_t  wanted = rx.wanted() < sizeof(chunk) ? rx.wanted() : sizeof(chunk);
+                size_t  n      = uart.readBytes(chunk, wanted, gapTicks);
+                rx.feed(chunk, n, micros());
+            }
+
+            if (rx.exception()) {
+                // The VFD understood and refused; asking again will not help
+                log_info("Spindle RS485 exception " << int(rx.exceptionCode()));
+                return Outcome::Failed;
+            }
+            if (rx.valid() && (cmd.rx_length == 0 || rx.length() == cmd.rx_length)) {
+                return Outcome::Ok;
+            }
+            reportCmdErrors(cmd, rx.data(), rx.length(), _modbus_id);
+
+#ifdef DEBUG_TASK_STACK
+            static UBaseType_t uxHighWaterMark = 0;
+            reportTaskStackSize(uxHighWaterMark);
+#endif
+        }
+        return Outcome::Failed;
+    }
+
+    // The communications task.  Commands from the queue are sent as soon
+    // as they arrive; status polls fill the time in between, one every
+    // VFD_RS485_POLL_RATE, or VFD_RS485_SYNC_POLL while setState() waits
+    // for the speed, and give way to commands.
     void VFD::vfd_cmd_task(void* pvParameters) {
         static bool unresponsive = false;  // to pop off a message once each time it becomes unresponsive
         static int  pollidx      = -1;
 
+        static Modbus::FrameReceiver rx;  // Too large for the task stack
+
         VFD*          instance = static_cast<VFD*>(pvParameters);
-        auto&         uart     = *instance->_uart;
         ModbusCommand next_cmd;
-        uint8_t       rx_message[VFD_RS485_MAX_MSG_SIZE];
         bool          safetyPollingEnabled = instance->safety_polling();
+        TickType_t    lastPoll             = xTaskGetTickCount();
 
-        for (; true; vTaskDelay(VFD_RS485_POLL_RATE / portTICK_PERIOD_MS)) {
+        while (true) {
             std::atomic_thread_fence(std::memory_order::memory_order_seq_cst);  // read fence for settings
             response_parser parser = nullptr;
 
             // First check if we should ask the VFD for the speed parameters as part of the initialization.
             if (pollidx < 0 && (parser = instance->initialization_sequence(pollidx, next_cmd)) != nullptr) {
+                if (unresponsive) {
+                    vTaskDelay(VFD_RS485_POLL_RATE / portTICK_PERIOD_MS);  // Do not hammer a VFD that is not there
+                }
             } else {
                 pollidx = 1;  // Done with initialization. Main sequence.
             }
             next_cmd.critical = false;
 
+            bool      raw         = false;
+            bool      preemptible = false;
             VFDaction action;
             if (parser == nullptr) {
-                // If we don't have a parser, the queue goes first.
-                if (xQueueReceive(vfd_cmd_queue, &action, 0)) {
+                // If we don't have a parser, the queue goes first.  Wait for
+                // a command until the next status poll is due.
+                TickType_t interval = (instance->_syncing ? VFD_RS485_SYNC_POLL : VFD_RS485_POLL_RATE) / portTICK_PERIOD_MS;
+                TickType_t elapsed  = xTaskGetTickCount() - lastPoll;
+                TickType_t wait     = elapsed < interval ? interval - elapsed : 0;
+                if (xQueueReceive(vfd_cmd_queue, &action, wait)) {
                     switch (action.action) {
                         case actionSetSpeed:
                             if (!instance->prepareSetSpeedCommand(action.arg, next_cmd)) {
@@ -107,10 +172,17 @@ namespace Spindles {
                             }
                             next_cmd.critical = action.critical;
                             break;
+                        case actionRaw:
+                            memcpy(next_cmd.msg + 1, action.raw, action.arg);
+                            next_cmd.tx_length = action.arg + 1;
+                            next_cmd.rx_length = 0;  // Unknown; the frame ends with the line going quiet
+                            raw                = true;
+                            break;
                     }
                 } else {
                     // We do not have a parser and there is nothing in the queue, so we cycle
                     // through the set of periodic queries.
+                    lastPoll = xTaskGetTickCount();
 
                     // We poll in a cycle. Note that the switch will fall through unless we encounter a hit.
                     // The weakest form here is 'get_status_ok' which should be implemented if the rest fails.
@@ -148,6 +220,7 @@ namespace Spindles {
                     if (parser == nullptr) {
                         continue;  // main loop
                     }
+                    preemptible = true;
                 }
             }
 
@@ -157,10 +230,10 @@ namespace Spindles {
                 next_cmd.msg[0] = instance->_modbus_id;
 
                 // Grabbed the command. Add the CRC16 checksum:
-                auto crc16                         = ModRTU_CRC(next_cmd.msg, next_cmd.tx_length);
-                next_cmd.msg[next_cmd.tx_length++] = (crc16 & 0xFF);
-                next_cmd.msg[next_cmd.tx_length++] = (crc16 & 0xFF00) >> 8;
-                next_cmd.rx_length += 2;
+                next_cmd.tx_length = Modbus::appendCrc(next_cmd.msg, next_cmd.tx_length);
+                if (next_cmd.rx_length) {
+                    next_cmd.rx_length += 2;
+                }
 
 #ifdef DEBUG_VFD_ALL
                 if (parser == nullptr) {
@@ -169,75 +242,37 @@ namespace Spindles {
 #endif
             }
 
-            // Assume for the worst, and retry...
-            int retry_count = 0;
-            for (; retry_count < MAX_RETRIES; ++retry_count) {
-                // Flush the UART and write the data:
-                uart.flush();
-                uart.write(next_cmd.msg, next_cmd.tx_length);
-                uart.flushTxTimed(response_ticks);
-
-                // Read the response
-                size_t read_length  = 0;
-                size_t current_read = uart.readBytes(rx_message, next_cmd.rx_length, response_ticks);
-                read_length += current_read;
-
-                // Apparently some Huanyang report modbus errors in the correct way, and the rest not. Sigh.
-                // Let's just check for the condition, and truncate the first byte.
-                if (read_length > 0 && instance->_modbus_id != 0 && rx_message[0] == 0) {
-                    memmove(rx_message + 1, rx_message, read_length - 1);
-                }
-
-                while (read_length < next_cmd.rx_length && current_read > 0) {
-                    // Try to read more; we're not there yet...
-                    current_read = uart.readBytes(rx_message + read_length, next_cmd.rx_length - read_length, response_ticks);
-                    read_length += current_read;
+            Outcome outcome = instance->transact(next_cmd, rx, preemptible);
+            if (raw) {
+                if (rx.state() == Modbus::FrameReceiver::State::Complete) {
+                    hex_msg(rx.data(), outcome == Outcome::Ok ? "VFD Rx:" : "VFD Rx (bad CRC):", rx.length());
+                } else {
+                    log_info("VFD Rx: no response");
                 }
+                continue;
+            }
 
-                // Generate crc16 for the response:
-                auto crc16response = ModRTU_CRC(rx_message, next_cmd.rx_length - 2);
-
-                if (read_length == next_cmd.rx_length &&                             // check expected length
-                    rx_message[0] == instance->_modbus_id &&                         // check address
-                    rx_message[read_length - 1] == (crc16response & 0xFF00) >> 8 &&  // check CRC byte 1
-                    rx_message[read_length - 2] == (crc16response & 0xFF)) {         // check CRC byte 1
-
-                    // Success
-                    unresponsive = false;
-                    retry_count  = MAX_RETRIES + 1;  // stop retry'ing
+            if (outcome == Outcome::Ok) {
+                unresponsive = false;
 
-                    // Should we parse this?
-                    if (parser != nullptr) {
-                        if (parser(rx_message, instance)) {
-                            // If we're initializing, move to the next initialization command:
-                            if (pollidx < 0) {
-                                --pollidx;
-                            }
-                        } else {
-                            // Parsing failed
-                            reportParsingErrors(next_cmd, rx_message, read_length);
-
-                            // If we were initializing, move back to where we started.
-                            unresponsive = true;
-                            pollidx      = -1;  // Re-initializing the VFD seems like a plan
-                            log_info("Spindle RS485 did not give a satisfying response");
+                // Should we parse this?
+                if (parser != nullptr) {
+                    if (parser(rx.data(), instance)) {
+                        // If we're initializing, move to the next initialization command:
+                        if (pollidx < 0) {
+                            --pollidx;
                         }
+                    } else {
+                        // Parsing failed
+                        reportParsingErrors(next_cmd, rx.data(), rx.length());
+
+                        // If we were initializing, move back to where we started.
+                        unresponsive = true;
+                        pollidx      = -1;  // Re-initializing the VFD seems like a plan
+                        log_info("Spindle RS485 did not give a satisfying response");
                     }
-                } else {
-                    reportCmdErrors(next_cmd, rx_message, read_length, instance->_modbus_id);
-
-                    // Wait a bit before we retry. Set the delay to poll-rate. Not sure
-                    // if we should use a different value...
-                    vTaskDelay(VFD_RS485_POLL_RATE / portTICK_PERIOD_MS);
-
-#ifdef DEBUG_TASK_STACK
-                    static UBaseType_t uxHighWaterMark = 0;
-                    reportTaskStackSize(uxHighWaterMark);
-#endif
                 }
-            }
-
-            if (retry_count == MAX_RETRIES) {
+            } else if (outcome == Outcome::Failed) {
                 if (!unresponsive) {
                     log_info("Spindle RS485 Unresponsive");
                     unresponsive = true;
@@ -313,6 +348,8 @@ namespace Spindles {
         uint32_t dev_speed = mapSpeed(speed);
         log_debug("Speed:" << speed << " linearized:" << dev_speed);
 
+        SpindleState previous = _current_state;  // The VFD task updates _current_state
+
         if (_current_state != state) {
             // Changing state
             set_mode(state, critical);  // critical if we are in a job
@@ -337,33 +374,55 @@ namespace Spindles {
             auto minSpeedAllowed = dev_speed > _slop ? (dev_speed - _slop) : 0;
             auto maxSpeedAllowed = dev_speed + _slop;
 
-            int       unchanged = 0;
-            const int limit     = 20;  // 20 * 0.5s = 10 sec
-            auto      last      = _sync_dev_speed;
+            // Once the ramp rate has been learned, most of the predicted ramp
+            // time is spent in one dwell.  After that the wait ends on the
+            // first speed report within tolerance.
+            bool     reversing = previous != state && previous != SpindleState::Disable && state != SpindleState::Disable;
+            uint32_t from      = reversing ? 0 : _synced_dev_speed;
+            bool     up        = dev_speed > from;
+            uint32_t delta     = up ? dev_speed - from : from - dev_speed;
+            if (reversing) {
+                delta += _synced_dev_speed;
+            }
+            uint32_t rate  = up ? _ramp_up_rate : _ramp_down_rate;
+            uint32_t start = millis();
+            if (rate) {
+                uint32_t predicted = uint32_t(uint64_t(delta) * 1000 / rate);
+                if (predicted > 4 * VFD_RS485_SYNC_POLL) {
+                    mc_dwell(predicted * 3 / 4);
+                }
+            }
+
+            uint32_t unchanged = 0;  // ms that the reported speed has not changed
+            auto     last      = _sync_dev_speed;
 
-            while ((_sync_dev_speed < minSpeedAllowed || _sync_dev_speed > maxSpeedAllowed) && unchanged < limit) {
+            while ((_sync_dev_speed < minSpeedAllowed || _sync_dev_speed > maxSpeedAllowed) && unchanged < VFD_SYNC_LIMIT_MS) {
 #ifdef DEBUG_VFD
                 log_debug("Syncing speed. Requested: " << int(dev_speed) << " current:" << int(_sync_dev_speed));
 #endif
-                if (!mc_dwell(500)) {
+                if (!mc_dwell(VFD_RS485_SYNC_POLL)) {
                     // Something happened while we were dwelling, like a safety door.
-                    unchanged = limit;
+                    unchanged = VFD_SYNC_LIMIT_MS;
                     last      = _sync_dev_speed;
                     break;
                 }
 
-                // unchanged counts the number of consecutive times that we see the same speed
-                unchanged = (_sync_dev_speed == last) ? unchanged + 1 : 0;
+                unchanged = (_sync_dev_speed == last) ? unchanged + VFD_RS485_SYNC_POLL : 0;
                 last      = _sync_dev_speed;
             }
 #ifdef DEBUG_VFD
             log_debug("Synced speed. Requested:" << int(dev_speed) << " current:" << int(_sync_dev_speed));
 #endif
 
-            if (unchanged == limit) {
+            if (unchanged >= VFD_SYNC_LIMIT_MS) {
                 log_error("Critical Spindle RS485 did not reach speed " << dev_speed << ". Reported speed is " << _sync_dev_speed);
                 mc_reset();
                 rtAlarm = ExecAlarm::SpindleControl;
+            } else {
+                if (!reversing) {
+                    learnRamp(delta, millis() - start, up);
+                }
+                _synced_dev_speed = dev_speed;
             }
 
             _syncing = false;
@@ -420,6 +479,30 @@ namespace Spindles {
         }
     }
 
+    // Folds a measured ramp into the model.  Small changes are dominated
+    // by the poll interval and are not used.
+    void VFD::learnRamp(uint32_t delta, uint32_t ms, bool up) {
+        if (delta <= 4 * _slop || ms < 2 * VFD_RS485_SYNC_POLL) {
+            return;
+        }
+        uint32_t  measured = uint32_t(uint64_t(delta) * 1000 / ms);
+        uint32_t& rate     = up ? _ramp_up_rate : _ramp_down_rate;
+        rate               = rate ? (rate + measured) / 2 : measured;
+        log_debug("VFD ramp " << (up ? "up " : "down ") << measured << "/s, model " << rate << "/s");
+    }
+
+    bool VFD::sendRaw(const uint8_t* msg, size_t len) {
+        if (!vfd_cmd_queue || len == 0 || len > VFD_RS485_MAX_MSG_SIZE - 3) {  // Room for the address and CRC
+            return false;
+        }
+        VFDaction action;
+        action.action   = actionRaw;
+        action.arg      = len;
+        action.critical = false;
+        memcpy(action.raw, msg, len);
+        return xQueueSend(vfd_cmd_queue, &action, 0) == pdTRUE;
+    }
+
     bool VFD::prepareSetSpeedCommand(uint32_t speed, ModbusCommand& data) {
         log_debug("prep speed " << speed << " curr " << _current_dev_speed);
         if (speed == _current_dev_speed) {  // prevent setting same speed twice
@@ -439,26 +522,4 @@ namespace Spindles {
 
         return true;
     }
-
-    // Calculate the CRC on all of the byte except the last 2
-    // It then added the CRC to those last 2 bytes
-    // full_msg_len This is the length of the message including the 2 crc bytes
-    // Source: https://ctlsys.com/support/how_to_compute_the_modbus_rtu_message_crc/
-    uint16_t VFD::ModRTU_CRC(uint8_t* buf, int msg_len) {
-        uint16_t crc = 0xFFFF;
-        for (int pos = 0; pos < msg_len; pos++) {
-            crc ^= uint16_t(buf[pos]);  // XOR byte into least sig. byte of crc.
-
-            for (int i = 8; i != 0; i--) {  // Loop over each bit
-                if ((crc & 0x0001) != 0) {  // If the LSB is set
-                    crc >>= 1;              // Shift right and XOR 0xA001
-                    crc ^= 0xA001;
-                } else {        // Else LSB is not set
-                    crc >>= 1;  // Just shift right
-                }
-            }
-        }
-
-        return crc;
-    }
 }
@@ -7,6 +7,7 @@
 #include "Spindle.h"
 
 #include "../Uart.h"
+#include "../Modbus.h"
 
 // #define DEBUG_VFD
 // #define DEBUG_VFD_ALL
@@ -28,12 +29,12 @@ namespace Spindles {
         static TaskHandle_t  vfd_cmdTaskHandle;
         static void          vfd_cmd_task(void* pvParameters);
 
-        static uint16_t ModRTU_CRC(uint8_t* buf, int msg_len);
-        enum VFDactionType : uint8_t { actionSetSpeed, actionSetMode };
+        enum VFDactionType : uint8_t { actionSetSpeed, actionSetMode, actionRaw };
         struct VFDaction {
             VFDactionType action;
             bool          critical;
-            uint32_t      arg;
+            uint32_t      arg;                          // For actionRaw, the length of raw
+            uint8_t       raw[VFD_RS485_MAX_MSG_SIZE];  // Function code and data, without address and CRC
         };
 
     protected:
@@ -49,8 +50,13 @@ namespace Spindles {
         bool prepareSetModeCommand(SpindleState mode, ModbusCommand& data);
         bool prepareSetSpeedCommand(uint32_t speed, ModbusCommand& data);
 
-        static void reportParsingErrors(ModbusCommand cmd, uint8_t* rx_message, size_t read_length);
-        static void reportCmdErrors(ModbusCommand cmd, uint8_t* rx_message, size_t read_length, uint8_t id);
+        static void reportParsingErrors(const ModbusCommand& cmd, const uint8_t* rx_message, size_t read_length);
+        static void reportCmdErrors(const ModbusCommand& cmd, const uint8_t* rx_message, size_t read_length, uint8_t id);
+
+        void learnRamp(uint32_t delta, uint32_t ms, bool up);
+
+        enum class Outcome : uint8_t { Ok, Failed, Preempted };
+        Outcome transact(const ModbusCommand& cmd, Modbus::FrameReceiver& rx, bool preemptible);
 
     protected:
         // Commands:
@@ -87,9 +93,20 @@ namespace Spindles {
         void setState(SpindleState state, SpindleSpeed speed);
         void setSpeedfromISR(uint32_t dev_speed) override;
 
+        // Queues a request for the active VFD and logs the response.
+        // msg holds the function code and data; the address and CRC are
+        // added.  Returns false if there is no VFD or the queue is full.
+        static bool sendRaw(const uint8_t* msg, size_t len);
+
         volatile uint32_t _sync_dev_speed;
         SpindleSpeed      _slop;
 
+        // Speed ramp model, in device speed units per second, learned from
+        // the speed reports while syncing.  0 until measured.
+        uint32_t _ramp_up_rate     = 0;
+        uint32_t _ramp_down_rate   = 0;
+        uint32_t _synced_dev_speed = 0;  // Where the last sync ended
+
         // Configuration handlers:
         void validate() const override {
             Spindle::validate();
@@ -15,6 +15,7 @@
 #include "StepperPrivate.h"
 #include "Planner.h"
 #include "Protocol.h"
+#include "Trace.h"
 #include <esp_attr.h>  // IRAM_ATTR
 
 using namespace Stepper;
@@ -207,9 +208,11 @@ void IRAM_ATTR Stepper::pulse_func() {
             }
             // Set real-time spindle output as segment is loaded, just prior to the first step.
             spindle->setSpeedfromISR(st.exec_segment->spindle_dev_speed);
+            TRACE(SegmentStart, st.exec_segment->n_step, st.exec_block_index);
         } else {
             // Segment buffer empty. Shutdown.
             stop_stepping();
+            TRACE(SegmentsEmpty, 0, 0);
             if (sys.state != State::Jog) {  // added to prevent ... jog after probing crash
                 // Ensure pwm is set properly upon completion of rate-controlled motion.
                 if (st.exec_block != NULL && st.exec_block->is_pwm_rate_adjusted) {
@@ -713,6 +716,7 @@ void Stepper::prep_buffer() {
         prep_segment->isrPeriod = timerTicks > 0xffff ? 0xffff : timerTicks;
 
         // Segment complete! Increment segment buffer indices, so stepper ISR can immediately execute it.
+        TRACE(SegmentPrep, prep_segment->n_step, prep_segment->st_block_index);
         segment_buffer_head = segment_next_head;
         if (++segment_next_head == SEGMENT_BUFFER_SIZE) {
             segment_next_head = 0;
@@ -0,0 +1,93 @@
+// Copyright (c) 2021 -  FluidNC contributors
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#include "Trace.h"
+
+#ifdef ENABLE_TRACE
+
+#    include <Arduino.h>  // millis()
+#    include <Print.h>
+#    include <cstring>
+#    include <freertos/FreeRTOS.h>  // portMUX_TYPE
+
+namespace Trace {
+    static Record        ring[ringSize];
+    static uint32_t      nextRecord = 0;  // Total number of records written
+    static volatile bool paused     = false;
+    static portMUX_TYPE  traceMux   = portMUX_INITIALIZER_UNLOCKED;
+
+    static inline uint32_t IRAM_ATTR cycleCount() {
+        uint32_t ccount;
+        __asm__ __volatile__("rsr %0,ccount" : "=a"(ccount));
+        return ccount;
+    }
+
+    void IRAM_ATTR record(Event event, uint16_t a, uint32_t b) {
+        if (paused) {
+            return;
+        }
+        // The timestamp is taken inside the lock so records are in time order
+        portENTER_CRITICAL_ISR(&traceMux);
+        Record& r = ring[nextRecord++ & (ringSize - 1)];
+        r.cycles  = cycleCount();
+        r.millis  = millis();
+        r.event   = uint16_t(event);
+        r.a       = a;
+        r.b       = b;
+        portEXIT_CRITICAL_ISR(&traceMux);
+    }
+
+    void clear() {
+        portENTER_CRITICAL(&traceMux);
+        nextRecord = 0;
+        portEXIT_CRITICAL(&traceMux);
+    }
+
+    static void writeHex(Print& out, const uint8_t* data, size_t len) {
+        static const char digits[] = "0123456789abcdef";
+        char              line[2 * sizeof(Record) + 2];
+        size_t            n = 0;
+        for (size_t i = 0; i < len; i++) {
+            line[n++] = digits[data[i] >> 4];
+            line[n++] = digits[data[i] & 0xf];
+        }
+        line[n++] = '\n';
+        out.write(reinterpret_cast<const uint8_t*>(line), n);
+    }
+
+    void dump(Print& out, bool hex) {
+        paused = true;
+
+        // Wait for a record() that started before the pause to finish
+        portENTER_CRITICAL(&traceMux);
+        uint32_t total = nextRecord;
+        portEXIT_CRITICAL(&traceMux);
+
+        uint32_t count = total < ringSize ? total : ringSize;
+        uint32_t first = total - count;
+
+        DumpHeader header;
+        memcpy(header.magic, "FNCT", 4);
+        header.version     = 1;
+        header.recordSize  = sizeof(Record);
+        header.count       = count;
+        header.cyclesPerUs = getCpuFrequencyMhz();
+
+        auto write = [&out, hex](const void* data, size_t len) {
+            if (hex) {
+                writeHex(out, static_cast<const uint8_t*>(data), len);
+            } else {
+                out.write(static_cast<const uint8_t*>(data), len);
+            }
+        };
+
+        write(&header, sizeof(header));
+        for (uint32_t i = first; i < total; i++) {
+            write(&ring[i & (ringSize - 1)], sizeof(Record));
+        }
+
+        paused = false;
+    }
+}
+
+#endif
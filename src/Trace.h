@@ -0,0 +1,74 @@
+// Copyright (c) 2021 -  FluidNC contributors
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#pragma once
+
+#include "Config.h"  // ENABLE_TRACE
+
+#include <esp_attr.h>  // IRAM_ATTR
+#include <cstdint>
+
+class Print;
+
+// Binary trace of what the controller did, for post-mortem analysis of
+// timing problems.  Each record holds an event id, the CPU cycle counter,
+// millis() and two arguments.  Recording takes a spinlock for a few
+// instructions and is safe from ISRs and IRAM code such as
+// Stepper::pulse_func(), so the TRACE() macro can be used anywhere.
+//
+// The ring keeps the most recent records.  $Trace/Dump sends it to the
+// client as hex lines, or with a file name writes it to a file that can be
+// fetched with $Xmodem/Send.  tools/trace2json.py turns either form into
+// a Chrome trace / Perfetto JSON timeline.
+//
+// Without ENABLE_TRACE in Config.h, TRACE() compiles to nothing.
+namespace Trace {
+    enum class Event : uint16_t {
+        None          = 0,
+        StateChange   = 1,   // a = new State, b = previous State
+        Alarm         = 2,   // a = ExecAlarm
+        PlannerPush   = 3,   // a = blocks queued, b = line number
+        PlannerPop    = 4,   // a = blocks queued
+        SegmentPrep   = 5,   // a = steps in segment, b = stepper block index
+        SegmentStart  = 6,   // a = steps in segment, b = stepper block index
+        SegmentsEmpty = 7,   // The stepper ran out of segments and stopped
+        Spindle       = 8,   // a = SpindleState, b = speed
+        Limit         = 9,   // a = pin value, b = motor bit mask
+        User          = 100  // First id for custom code
+    };
+
+    struct __attribute__((packed)) Record {
+        uint32_t cycles;  // CPU cycle counter, wraps every few seconds
+        uint32_t millis;  // Used to unwrap cycles over longer spans
+        uint16_t event;
+        uint16_t a;
+        uint32_t b;
+    };
+
+    // Header of a dump, followed by count records, oldest first
+    struct __attribute__((packed)) DumpHeader {
+        char     magic[4];  // "FNCT"
+        uint16_t version;
+        uint16_t recordSize;
+        uint32_t count;
+        uint32_t cyclesPerUs;
+    };
+
+    const uint32_t ringSize = 512;  // Must be a power of 2
+
+    void IRAM_ATTR record(Event event, uint16_t a, uint32_t b);
+
+    void clear();
+
+    // Writes the dump to out in binary, or as hex lines when hex is true.
+    // Tracing is paused while the ring is copied.
+    void dump(Print& out, bool hex);
+}
+
+#ifdef ENABLE_TRACE
+#    define TRACE(event, a, b) Trace::record(Trace::Event::event, (a), (b))
+#else
+#    define TRACE(event, a, b)                                                                                                             \
+        do {                                                                                                                               \
+        } while (0)
+#endif
@@ -0,0 +1,28 @@
+// Copyright (c) 2021 -  FluidNC contributors
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#pragma once
+
+#include <Stream.h>
+#include <cstddef>
+#include <cstdint>
+
+// A byte transport that input clients are read from.  Stream reads one
+// byte per call, which for the ring buffered transports means one lock or
+// one index update per byte; read(buffer, length) takes everything that
+// has arrived at once.  The bulk write is Print::write(buffer, length).
+class Transport : public Stream {
+public:
+    using Stream::read;
+
+    // Moves up to length bytes that have already arrived into buffer and
+    // returns how many were moved.  Never waits for more to arrive.
+    virtual size_t read(uint8_t* buffer, size_t length) {
+        size_t n = 0;
+        int    c;
+        while (n < length && (c = read()) >= 0) {
+            buffer[n++] = c;
+        }
+        return n;
+    }
+};
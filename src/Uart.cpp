@@ -60,7 +60,7 @@ void Uart::begin(unsigned long baudrate, UartData dataBits, UartStop stopBits, U
     if (uart_param_config(_uart_num, &conf) != ESP_OK) {
         return;
     };
-    uart_driver_install(_uart_num, 256, 0, 0, NULL, 0);
+    uart_driver_install(_uart_num, rxBufferSize, 0, 0, NULL, 0);
 }
 
 int Uart::available() {
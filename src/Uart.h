@@ -7,16 +7,19 @@
 
 #include "Configuration/Configurable.h"
 #include "UartTypes.h"
+#include "Transport.h"
 
-#include <Stream.h>
 #include <freertos/FreeRTOS.h>  // TickType_T
 
-class Uart : public Stream, public Configuration::Configurable {
+class Uart : public Transport, public Configuration::Configurable {
 private:
     uart_port_t _uart_num;
     int         _pushback;
 
 public:
+    // Size of the driver's receive ring buffer
+    static const int rxBufferSize = 256;
+
     // These are public so that validators from classes
     // that use Uart can check that the setup is suitable.
     // E.g. some uses require an RTS pin.
@@ -43,6 +46,7 @@ public:
     int    available(void) override;
     int    read(void) override;
     int    read(TickType_t timeout);
+    size_t read(uint8_t* buffer, size_t length) override { return readBytes(buffer, length, TickType_t(0)); }
     size_t readBytes(char* buffer, size_t length, TickType_t timeout);
     size_t readBytes(uint8_t* buffer, size_t length, TickType_t timeout) {
         return readBytes(reinterpret_cast<char*>(buffer), length, timeout);
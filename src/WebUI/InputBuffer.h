@@ -3,12 +3,15 @@
 
 #pragma once
 
-#include <Stream.h>
+#include "../Transport.h"
+
 #include <cstring>
 
 namespace WebUI {
-    class InputBuffer : public Stream {
+    class InputBuffer : public Transport {
     public:
+        static const int RXBUFFERSIZE = 256;
+
         InputBuffer();
 
         size_t write(uint8_t c) override { return 0; }
@@ -27,8 +30,6 @@ namespace WebUI {
         ~InputBuffer();
 
     private:
-        static const int RXBUFFERSIZE = 256;
-
         uint8_t  _RXbuffer[RXBUFFERSIZE];
         uint16_t _RXbufferSize;
         uint16_t _RXbufferpos;
@@ -0,0 +1,199 @@
+// Copyright (c) 2021 -  FluidNC contributors
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#include "JobStream.h"
+
+#ifdef ENABLE_WIFI
+
+#    include "../Logging.h"
+
+#    include <WebSocketsServer.h>
+#    include <cstring>
+
+namespace WebUI {
+    JobStream jobStream;
+
+    // The running totals index the window directly, which needs a size
+    // that divides 2^32
+    static_assert((JobStream::WINDOW & (JobStream::WINDOW - 1)) == 0, "JobStream::WINDOW must be a power of two");
+
+    // An ACK is sent at once when this much of the window has been freed,
+    // otherwise changes are collected for up to ackIntervalMs
+    static const uint32_t ackBytes      = JobStream::WINDOW / 4;
+    static const uint32_t ackIntervalMs = 20;
+
+    // Bytes before _discardTo are dropped by the main loop, so they count as
+    // consumed as soon as JOB:STOP or a new JOB:START is seen.
+    uint32_t JobStream::consumed() const {
+        uint32_t consumed = _consumed;
+        uint32_t discard  = _discardTo;
+        return int32_t(discard - consumed) > 0 ? discard : consumed;
+    }
+
+    int JobStream::available() { return _received - consumed(); }
+
+    int JobStream::peek() {
+        uint32_t pos = consumed();
+        return pos == _received ? -1 : _window[pos % WINDOW];
+    }
+
+    int JobStream::read() {
+        _reader      = xTaskGetCurrentTaskHandle();
+        uint32_t pos = consumed();
+        if (pos == _received) {
+            _consumed = pos;
+            return -1;
+        }
+        int c     = _window[pos % WINDOW];
+        _consumed = pos + 1;
+        return c;
+    }
+
+    size_t JobStream::read(uint8_t* buffer, size_t length) {
+        _reader      = xTaskGetCurrentTaskHandle();
+        uint32_t pos = consumed();
+        size_t   n   = _received - pos;
+        if (n > length) {
+            n = length;
+        }
+        size_t index = pos % WINDOW;
+        size_t first = n < WINDOW - index ? n : WINDOW - index;
+        memcpy(buffer, &_window[index], first);
+        memcpy(buffer + first, &_window[0], n - first);
+        _consumed = pos + n;
+        return n;
+    }
+
+    size_t JobStream::write(uint8_t c) { return write(&c, 1); }
+
+    // Only output from the main loop, the task that reads the stream, is
+    // looked at.  Other tasks write broadcasts, which reach the browser
+    // through Serial2Socket anyway.
+    size_t JobStream::write(const uint8_t* buffer, size_t length) {
+        if (xTaskGetCurrentTaskHandle() != _reader) {
+            return length;
+        }
+        for (size_t i = 0; i < length; i++) {
+            char c = buffer[i];
+            if (c == '\n') {
+                _reply[_replyLen] = '\0';
+                replyLine();
+                _replyLen = 0;
+            } else if (c != '\r' && _replyLen < sizeof(_reply) - 1) {
+                _reply[_replyLen++] = c;
+            }
+        }
+        return length;
+    }
+
+    // Every line that is executed gets exactly one "ok" or "error:" reply
+    void JobStream::replyLine() {
+        if (strcmp(_reply, "ok") == 0) {
+            _acked = _acked + 1;
+        } else if (strncmp(_reply, "error:", 6) == 0) {
+            _acked = _acked + 1;
+            if (_errorsIn - _errorsOut < MAX_ERRORS) {
+                LineError& error = _errors[_errorsIn % MAX_ERRORS];
+                error.line       = _acked - _startAcked;
+                strncpy(error.text, _reply + 6, MAX_ERROR_LEN - 1);
+                error.text[MAX_ERROR_LEN - 1] = '\0';
+                _errorsIn                     = _errorsIn + 1;
+            }
+        }
+    }
+
+    void JobStream::handleText(WebSocketsServer* server, uint8_t num, const char* text) {
+        char msg[48];
+        if (strncmp(text, "JOB:START", 9) == 0) {
+            if (_client >= 0 && _client != num) {
+                server->sendTXT(num, "JOB:ERROR:BUSY");
+                return;
+            }
+            _discardTo        = _received;
+            _startReceived    = _received;
+            _startAcked       = _acked;
+            _startMs          = millis();
+            _reportedAcked    = 0;
+            _reportedConsumed = 0;
+            _reportedMs       = _startMs;
+            _errorsOut        = _errorsIn;
+            _client           = num;
+            snprintf(msg, sizeof(msg), "JOB:WINDOW:%u", unsigned(WINDOW));
+            server->sendTXT(num, msg);
+        } else if (strcmp(text, "JOB:STOP") == 0) {
+            if (_client == num) {
+                stop(server);
+            }
+        } else {
+            server->sendTXT(num, "JOB:ERROR:UNKNOWN");
+        }
+    }
+
+    void JobStream::handleBinary(WebSocketsServer* server, uint8_t num, const uint8_t* data, size_t length) {
+        if (_client != num) {
+            server->sendTXT(num, "JOB:ERROR:NOT_STARTED");
+            return;
+        }
+        uint32_t received = _received;
+        if (length > WINDOW - (received - consumed())) {
+            server->sendTXT(num, "JOB:ERROR:OVERFLOW");
+            return;
+        }
+        size_t pos   = received % WINDOW;
+        size_t first = length < WINDOW - pos ? length : WINDOW - pos;
+        memcpy(&_window[pos], data, first);
+        memcpy(&_window[0], data + first, length - first);
+        _received = received + length;  // Publish only after the copy
+    }
+
+    void JobStream::stop(WebSocketsServer* server) {
+        report(server);
+        _discardTo = _received;
+
+        uint32_t lines = _acked - _startAcked;
+        uint32_t bytes = _reportedConsumed;
+        uint32_t ms    = millis() - _startMs;
+        char     msg[64];
+        snprintf(msg, sizeof(msg), "JOB:DONE:%u:%u:%u", unsigned(lines), unsigned(bytes), unsigned(ms));
+        server->sendTXT(_client, msg);
+        log_info("Job stream " << lines << " lines, " << bytes << " bytes in " << ms << " ms");
+        _client = -1;
+    }
+
+    void JobStream::disconnected(uint8_t num) {
+        if (_client == num) {
+            _discardTo = _received;
+            _client    = -1;
+        }
+    }
+
+    void JobStream::report(WebSocketsServer* server) {
+        if (_client < 0) {
+            return;
+        }
+        char msg[64];
+        while (_errorsOut != _errorsIn) {
+            const LineError& error = _errors[_errorsOut % MAX_ERRORS];
+            snprintf(msg, sizeof(msg), "JOB:ERR:%u:%s", unsigned(error.line), error.text);
+            server->sendTXT(_client, msg);
+            _errorsOut = _errorsOut + 1;
+        }
+
+        uint32_t acked    = _acked - _startAcked;
+        uint32_t consumed = this->consumed() - _startReceived;
+        if (acked == _reportedAcked && consumed == _reportedConsumed) {
+            return;
+        }
+        uint32_t now = millis();
+        if ((consumed - _reportedConsumed) < ackBytes && (now - _reportedMs) < ackIntervalMs) {
+            return;
+        }
+        snprintf(msg, sizeof(msg), "JOB:ACK:%u:%u", unsigned(acked), unsigned(consumed));
+        server->sendTXT(_client, msg);
+        _reportedAcked    = acked;
+        _reportedConsumed = consumed;
+        _reportedMs       = now;
+    }
+}
+
+#endif
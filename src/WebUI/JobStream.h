@@ -0,0 +1,103 @@
+// Copyright (c) 2021 -  FluidNC contributors
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#pragma once
+
+#include "../Config.h"  // ENABLE_*
+
+#ifdef ENABLE_WIFI
+
+#    include "../Transport.h"
+#    include <freertos/FreeRTOS.h>
+#    include <freertos/task.h>
+
+class WebSocketsServer;
+
+namespace WebUI {
+    // A websocket sub-protocol for streaming G-code jobs, registered as an
+    // input client of its own.  Text frames control the stream and binary
+    // frames carry G-code:
+    //
+    //   client                      device
+    //   JOB:START                   JOB:WINDOW:<bytes>
+    //   <binary G-code lines>       JOB:ACK:<lines>:<consumed>
+    //                               JOB:ERR:<line>:<error>
+    //   JOB:STOP                    JOB:DONE:<lines>:<bytes>:<ms>
+    //
+    // The sender may have at most <bytes> sent that are not yet consumed.
+    // ACK reports the number of lines executed and the number of bytes
+    // the main loop has taken from the window since JOB:START.  The main
+    // loop takes lines only as fast as the planner accepts them, so the
+    // credit follows planner availability.
+    class JobStream : public Transport {
+    public:
+        static const uint32_t WINDOW = 4096;
+
+        // Stream, read by pollClients()
+        int    available() override;
+        int    read() override;
+        size_t read(uint8_t* buffer, size_t length) override;
+        int    peek() override;
+        void   flush() override {}
+
+        // Print, receives the replies to the lines that were executed
+        size_t write(uint8_t c) override;
+        size_t write(const uint8_t* buffer, size_t length) override;
+
+        // Called from the web services task
+        void handleText(WebSocketsServer* server, uint8_t num, const char* text);
+        void handleBinary(WebSocketsServer* server, uint8_t num, const uint8_t* data, size_t length);
+        void disconnected(uint8_t num);
+        void report(WebSocketsServer* server);
+
+    private:
+        static const int    MAX_ERRORS    = 8;
+        static const size_t MAX_ERROR_LEN = 24;
+
+        struct LineError {
+            uint32_t line;
+            char     text[MAX_ERROR_LEN];
+        };
+
+        uint8_t _window[WINDOW];
+
+        // Running totals.  _received is written only by the web services
+        // task and _consumed and _acked only by the main loop.
+        volatile uint32_t _received = 0;
+        volatile uint32_t _consumed = 0;
+        volatile uint32_t _acked    = 0;
+
+        // Unread bytes before this point belong to a stopped job and are
+        // dropped.  Set by the web services task.
+        volatile uint32_t _discardTo = 0;
+
+        // Values at JOB:START
+        uint32_t _startReceived = 0;
+        uint32_t _startAcked    = 0;
+        uint32_t _startMs       = 0;
+
+        // Last values sent in an ACK
+        uint32_t _reportedAcked    = 0;
+        uint32_t _reportedConsumed = 0;
+        uint32_t _reportedMs       = 0;
+
+        int          _client = -1;  // websocket client number, -1 when idle
+        TaskHandle_t _reader = nullptr;
+
+        // The reply line being assembled from main loop output
+        char   _reply[MAX_ERROR_LEN + 8];
+        size_t _replyLen = 0;
+
+        LineError         _errors[MAX_ERRORS];
+        volatile uint32_t _errorsIn  = 0;
+        volatile uint32_t _errorsOut = 0;
+
+        uint32_t consumed() const;
+        void     replyLine();
+        void     stop(WebSocketsServer* server);
+    };
+
+    extern JobStream jobStream;
+}
+
+#endif
@@ -13,7 +13,11 @@ namespace WebUI {
 #    include <WiFi.h>
 
 namespace WebUI {
+    static_assert(Serial_2_Socket::TXHEADROOM == WEBSOCKETS_MAX_HEADER_SIZE, "Serial_2_Socket headroom must fit a websocket header");
+
     Serial_2_Socket::Serial_2_Socket() {
+        _txLock       = xSemaphoreCreateRecursiveMutex();
+        _rxLock       = xSemaphoreCreateMutex();
         _web_socket   = NULL;
         _TXbufferSize = 0;
         _RXbufferSize = 0;
@@ -50,7 +54,12 @@ namespace WebUI {
 
     Serial_2_Socket::operator bool() const { return true; }
 
-    int Serial_2_Socket::available() { return _RXbufferSize; }
+    int Serial_2_Socket::available() {
+        xSemaphoreTake(_rxLock, portMAX_DELAY);
+        int size = _RXbufferSize;
+        xSemaphoreGive(_rxLock);
+        return size;
+    }
 
     size_t Serial_2_Socket::write(uint8_t c) {
         if (!_web_socket) {
@@ -71,35 +80,49 @@ namespace WebUI {
             return 0;
         }
 
-        if (_TXbufferSize == 0) {
-            _lastflush = millis();
+        xSemaphoreTakeRecursive(_txLock, portMAX_DELAY);
+        size_t done = 0;
+        while (done < size) {
+            if (_TXbufferSize == TXBUFFERSIZE) {
+                flush();
+            }
+            if (_TXbufferSize == 0) {
+                _lastflush = millis();
+            }
+            size_t n = size - done;
+            if (n > size_t(TXBUFFERSIZE - _TXbufferSize)) {
+                n = TXBUFFERSIZE - _TXbufferSize;
+            }
+            memcpy(_TXbuffer + TXHEADROOM + _TXbufferSize, buffer + done, n);
+            _TXbufferSize += n;
+            done += n;
         }
+        log_i("[SOCKET]buffer size %d", _TXbufferSize);
 
-        //send full line
-        if (_TXbufferSize + size > TXBUFFERSIZE) {
+        // A status report is sent at once so the GUI sees it without delay.
+        // Other complete lines are held briefly so that a burst of replies
+        // goes out as one frame; handle_flush() sends them when the window
+        // has passed.
+        if (lineComplete() && size >= 2 && buffer[size - 2] == '>') {
             flush();
+        } else {
+            handle_flush();
         }
-
-        //need periodic check to force to flush in case of no end
-        for (int i = 0; i < size; i++) {
-            _TXbuffer[_TXbufferSize] = buffer[i];
-            _TXbufferSize++;
-        }
-        log_i("[SOCKET]buffer size %d", _TXbufferSize);
-        handle_flush();
+        xSemaphoreGiveRecursive(_txLock);
         return size;
     }
 
     int Serial_2_Socket::peek(void) {
-        if (_RXbufferSize > 0) {
-            return _RXbuffer[_RXbufferpos];
-        } else {
-            return -1;
-        }
+        xSemaphoreTake(_rxLock, portMAX_DELAY);
+        int v = _RXbufferSize > 0 ? _RXbuffer[_RXbufferpos] : -1;
+        xSemaphoreGive(_rxLock);
+        return v;
     }
 
     bool Serial_2_Socket::push(const char* data) {
-        int data_size = strlen(data);
+        int  data_size = strlen(data);
+        bool pushed    = false;
+        xSemaphoreTake(_rxLock, portMAX_DELAY);
         if ((data_size + _RXbufferSize) <= RXBUFFERSIZE) {
             int current = _RXbufferpos + _RXbufferSize;
             if (current > RXBUFFERSIZE) {
@@ -114,45 +137,68 @@ namespace WebUI {
                 current++;
             }
 
-            _RXbufferSize += strlen(data);
-            return true;
+            _RXbufferSize += data_size;
+            pushed = true;
         }
-        return false;
+        xSemaphoreGive(_rxLock);
+        return pushed;
     }
 
     int Serial_2_Socket::read(void) {
-        handle_flush();
+        int v = -1;
+        xSemaphoreTake(_rxLock, portMAX_DELAY);
         if (_RXbufferSize > 0) {
-            int v = _RXbuffer[_RXbufferpos];
+            v = _RXbuffer[_RXbufferpos];
             _RXbufferpos++;
 
             if (_RXbufferpos > (RXBUFFERSIZE - 1)) {
                 _RXbufferpos = 0;
             }
             _RXbufferSize--;
-            return v;
-        } else {
-            return -1;
         }
+        xSemaphoreGive(_rxLock);
+        return v;
+    }
+
+    size_t Serial_2_Socket::read(uint8_t* buffer, size_t length) {
+        xSemaphoreTake(_rxLock, portMAX_DELAY);
+        size_t n = 0;
+        while (n < length && _RXbufferSize > 0) {
+            size_t contiguous = RXBUFFERSIZE - _RXbufferpos;
+            if (contiguous > _RXbufferSize) {
+                contiguous = _RXbufferSize;
+            }
+            if (contiguous > length - n) {
+                contiguous = length - n;
+            }
+            memcpy(buffer + n, &_RXbuffer[_RXbufferpos], contiguous);
+            n += contiguous;
+            _RXbufferpos = (_RXbufferpos + contiguous) % RXBUFFERSIZE;
+            _RXbufferSize -= contiguous;
+        }
+        xSemaphoreGive(_rxLock);
+        return n;
     }
 
     void Serial_2_Socket::handle_flush() {
-        if (_TXbufferSize > 0 && ((_TXbufferSize >= TXBUFFERSIZE) || ((millis() - _lastflush) > FLUSHTIMEOUT))) {
+        xSemaphoreTakeRecursive(_txLock, portMAX_DELAY);
+        uint32_t age = millis() - _lastflush;
+        if (_TXbufferSize > 0 && ((_TXbufferSize >= TXBUFFERSIZE) || (lineComplete() && age >= COALESCETIMEOUT) || age > FLUSHTIMEOUT)) {
             log_i("[SOCKET]need flush, buffer size %d", _TXbufferSize);
             flush();
         }
+        xSemaphoreGiveRecursive(_txLock);
     }
     void Serial_2_Socket::flush(void) {
-        if (_TXbufferSize > 0) {
+        xSemaphoreTakeRecursive(_txLock, portMAX_DELAY);
+        if (_TXbufferSize > 0 && _web_socket) {
             log_i("[SOCKET]flush data, buffer size %d", _TXbufferSize);
-            _web_socket->broadcastBIN(_TXbuffer, _TXbufferSize);
-
-            //refresh timout
-            _lastflush = millis();
+            _web_socket->broadcastBIN(_TXbuffer, _TXbufferSize, true);
 
             //reset buffer
             _TXbufferSize = 0;
         }
+        xSemaphoreGiveRecursive(_txLock);
     }
 
     Serial_2_Socket::~Serial_2_Socket() {
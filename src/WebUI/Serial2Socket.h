@@ -21,17 +21,22 @@ namespace WebUI {
 }
 #else
 
-#    include <Stream.h>
+#    include "../Transport.h"
+#    include <freertos/FreeRTOS.h>
+#    include <freertos/semphr.h>
 
 class WebSocketsServer;
 
 namespace WebUI {
-    class Serial_2_Socket : public Stream {
-        static const int TXBUFFERSIZE = 1200;
-        static const int RXBUFFERSIZE = 256;
-        static const int FLUSHTIMEOUT = 500;
+    class Serial_2_Socket : public Transport {
+        static const int TXBUFFERSIZE    = 1200;
+        static const int TXHEADROOM      = 14;   // WEBSOCKETS_MAX_HEADER_SIZE
+        static const int FLUSHTIMEOUT    = 500;  // ms, for output without a line end
+        static const int COALESCETIMEOUT = 10;   // ms, for complete lines
 
     public:
+        static const int RXBUFFERSIZE = 256;
+
         Serial_2_Socket();
 
         size_t write(uint8_t c);
@@ -43,29 +48,47 @@ namespace WebUI {
         inline size_t write(unsigned int n) { return write((uint8_t)n); }
         inline size_t write(int n) { return write((uint8_t)n); }
 
-        long baudRate();
-        void begin(long speed);
-        void end();
-        int  available();
-        int  peek(void);
-        int  read(void);
-        bool push(const char* data);
-        void flush(void);
-        void handle_flush();
-        bool attachWS(WebSocketsServer* web_socket);
-        bool detachWS();
+        long   baudRate();
+        void   begin(long speed);
+        void   end();
+        int    available();
+        int    peek(void);
+        int    read(void);
+        size_t read(uint8_t* buffer, size_t length) override;
+        bool   push(const char* data);
+        void   flush(void);
+        void   handle_flush();
+        bool   attachWS(WebSocketsServer* web_socket);
+        bool   detachWS();
+
+        // Serializes use of the websocket server between the web services
+        // task and the output queue task that writes here
+        void lock() { xSemaphoreTakeRecursive(_txLock, portMAX_DELAY); }
+        void unlock() { xSemaphoreGiveRecursive(_txLock); }
 
         operator bool() const;
 
         ~Serial_2_Socket();
 
     private:
-        uint32_t          _lastflush;
+        uint32_t          _lastflush;  // When the oldest buffered byte arrived
         WebSocketsServer* _web_socket;
 
-        uint8_t  _TXbuffer[TXBUFFERSIZE];
+        // The transmit buffer is filled by the client's output queue task
+        // and flushed from the web services task
+        SemaphoreHandle_t _txLock;
+
+        // The receive buffer is filled by the web services task and read
+        // by the main loop
+        SemaphoreHandle_t _rxLock;
+
+        // The websocket frame header is built in the headroom in front of
+        // the data, so a frame is sent straight from this buffer
+        uint8_t  _TXbuffer[TXHEADROOM + TXBUFFERSIZE];
         uint16_t _TXbufferSize;
 
+        bool lineComplete() const { return _TXbufferSize && _TXbuffer[TXHEADROOM + _TXbufferSize - 1] == '\n'; }
+
         uint8_t  _RXbuffer[RXBUFFERSIZE];
         uint16_t _RXbufferSize;
         uint16_t _RXbufferpos;
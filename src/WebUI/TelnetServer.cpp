@@ -15,28 +15,140 @@ namespace WebUI {
 
 #    include "WifiConfig.h"
 #    include "../Report.h"  // report_init_message()
-#    include "Commands.h"   // COMMANDS
 
 #    include <WiFi.h>
+#    include <lwip/sockets.h>  // select()
 
 namespace WebUI {
+    Telnet_Session::Telnet_Session() : _client(new WiFiClient()), _RXhead(0), _RXtail(0) { _lock = xSemaphoreCreateMutex(); }
+
+    bool Telnet_Session::connected() {
+        xSemaphoreTake(_lock, portMAX_DELAY);
+        bool result = *_client && _client->connected();
+        xSemaphoreGive(_lock);
+        return result;
+    }
+
+    void Telnet_Session::attach(WiFiClient& client) {
+        xSemaphoreTake(_lock, portMAX_DELAY);
+        *_client = client;
+        _client->setNoDelay(true);
+        _RXtail = _RXhead;  // Discard anything left over from the previous connection
+        xSemaphoreGive(_lock);
+        log_info("Telnet client " << client.remoteIP().toString() << " connected");
+        report_init_message(*this);
+    }
+
+    void Telnet_Session::detach() {
+        xSemaphoreTake(_lock, portMAX_DELAY);
+        if (*_client) {
+            _client->stop();
+        }
+        xSemaphoreGive(_lock);
+    }
+
+    int Telnet_Session::rxSpace() const {
+        // One slot stays empty so that a full ring can be told from an empty one
+        return RXBUFFERSIZE - 1 - ((_RXhead + RXBUFFERSIZE - _RXtail) % RXBUFFERSIZE);
+    }
+
+    // Moves whatever the socket has into the ring, as far as it fits.
+    // Returns the number of bytes moved.  Called only by the telnet task.
+    size_t Telnet_Session::receive() {
+        size_t total = 0;
+        xSemaphoreTake(_lock, portMAX_DELAY);
+        while (*_client && _client->available()) {
+            int space = rxSpace();
+            if (space <= 0) {
+                break;
+            }
+            uint16_t head       = _RXhead;
+            int      contiguous = RXBUFFERSIZE - head;
+            if (contiguous > space) {
+                contiguous = space;
+            }
+            int n = _client->read(&_RXbuffer[head], contiguous);
+            if (n <= 0) {
+                break;
+            }
+            _RXhead = (head + n) % RXBUFFERSIZE;
+            total += n;
+        }
+        xSemaphoreGive(_lock);
+        return total;
+    }
+
+    size_t Telnet_Session::write(uint8_t data) { return write(&data, 1); }
+
+    size_t Telnet_Session::write(const uint8_t* buffer, size_t size) {
+        xSemaphoreTake(_lock, portMAX_DELAY);
+        if (*_client && _client->connected()) {
+            _client->write(buffer, size);
+        }
+        xSemaphoreGive(_lock);
+        return size;
+    }
+
+    int Telnet_Session::available() { return (_RXhead + RXBUFFERSIZE - _RXtail) % RXBUFFERSIZE; }
+
+    int Telnet_Session::peek(void) {
+        if (_RXhead == _RXtail) {
+            return -1;
+        }
+        return _RXbuffer[_RXtail];
+    }
+
+    int Telnet_Session::read(void) {
+        uint16_t tail = _RXtail;
+        if (_RXhead == tail) {
+            return -1;
+        }
+        int v   = _RXbuffer[tail];
+        _RXtail = (tail + 1) % RXBUFFERSIZE;
+        return v;
+    }
+
+    size_t Telnet_Session::read(uint8_t* buffer, size_t length) {
+        uint16_t head = _RXhead;
+        uint16_t tail = _RXtail;
+        size_t   n    = 0;
+        while (n < length && tail != head) {
+            size_t contiguous = (head > tail ? head : RXBUFFERSIZE) - tail;
+            if (contiguous > length - n) {
+                contiguous = length - n;
+            }
+            memcpy(buffer + n, &_RXbuffer[tail], contiguous);
+            n += contiguous;
+            tail = (tail + contiguous) % RXBUFFERSIZE;
+        }
+        _RXtail = tail;
+        return n;
+    }
+
+    Telnet_Session::~Telnet_Session() {
+        detach();
+        delete _client;
+    }
+
     bool        Telnet_Server::_setupdone    = false;
     uint16_t    Telnet_Server::_port         = 0;
     WiFiServer* Telnet_Server::_telnetserver = NULL;
-    WiFiClient  Telnet_Server::_telnetClients[MAX_TLNT_CLIENTS];
 
-    IPAddress Telnet_Server::_telnetClientsIP[MAX_TLNT_CLIENTS];
+    Telnet_Server::Telnet_Server() : _task(nullptr) { _lock = xSemaphoreCreateMutex(); }
 
-    Telnet_Server::Telnet_Server() {
-        _RXbufferSize = 0;
-        _RXbufferpos  = 0;
+    const std::vector<Telnet_Session*>& Telnet_Server::sessions() {
+        if (_sessions.empty()) {
+            int n = telnet_max_clients ? telnet_max_clients->get() : 1;
+            for (int i = 0; i < n; i++) {
+                _sessions.push_back(new Telnet_Session());
+            }
+        }
+        return _sessions;
     }
 
     bool Telnet_Server::begin() {
         bool no_error = true;
         end();
-        _RXbufferSize = 0;
-        _RXbufferpos  = 0;
 
         if (!WebUI::telnet_enable->get()) {
             return false;
@@ -44,172 +156,114 @@ namespace WebUI {
         _port = WebUI::telnet_port->get();
 
         //create instance
-        _telnetserver = new WiFiServer(_port, MAX_TLNT_CLIENTS);
+        xSemaphoreTake(_lock, portMAX_DELAY);
+        _telnetserver = new WiFiServer(_port, sessions().size());
         _telnetserver->setNoDelay(true);
-        log_info("Telnet started on port " << _port);
+        log_info("Telnet started on port " << _port << " for " << int(sessions().size()) << " clients");
         //start telnet server
         _telnetserver->begin();
         _setupdone = true;
+        xSemaphoreGive(_lock);
+
+        if (!_task) {
+            xTaskCreatePinnedToCore(telnetTask,    // task
+                                    "telnetTask",  // name for task
+                                    4096,          // size of task stack
+                                    this,          // parameters
+                                    1,             // priority
+                                    &_task,
+                                    SUPPORT_TASK_CORE  // core
+            );
+        }
         return no_error;
     }
 
     void Telnet_Server::end() {
-        _setupdone    = false;
-        _RXbufferSize = 0;
-        _RXbufferpos  = 0;
+        xSemaphoreTake(_lock, portMAX_DELAY);
+        _setupdone = false;
+        for (auto session : _sessions) {
+            session->detach();
+        }
         if (_telnetserver) {
             delete _telnetserver;
             _telnetserver = NULL;
         }
+        xSemaphoreGive(_lock);
     }
 
-    void Telnet_Server::clearClients() {
-        //check if there are any new clients
-        if (_telnetserver->hasClient()) {
-            size_t i;
-            for (i = 0; i < MAX_TLNT_CLIENTS; i++) {
-                //find free/disconnected spot
-                if (!_telnetClients[i] || !_telnetClients[i].connected()) {
-                    _telnetClientsIP[i] = IPAddress(0, 0, 0, 0);
-                    if (_telnetClients[i]) {
-                        _telnetClients[i].stop();
-                    }
-                    _telnetClients[i] = _telnetserver->available();
+    // Must be called with _lock held
+    void Telnet_Server::acceptClients() {
+        while (_telnetserver->hasClient()) {
+            WiFiClient client = _telnetserver->available();
+            bool       placed = false;
+            for (auto session : _sessions) {
+                if (!session->connected()) {
+                    session->attach(client);
+                    placed = true;
                     break;
                 }
             }
-            if (i >= MAX_TLNT_CLIENTS) {
+            if (!placed) {
                 //no free/disconnected spot so reject
-                _telnetserver->available().stop();
-            }
-        }
-    }
-
-    size_t Telnet_Server::write(uint8_t data) { return write(&data, 1); }
-
-    size_t Telnet_Server::write(const uint8_t* buffer, size_t size) {
-        size_t wsize = 0;
-        if (!_setupdone || _telnetserver == NULL) {
-            return 0;
-        }
-
-        clearClients();
-
-        //push UART data to all connected telnet clients
-        for (size_t i = 0; i < MAX_TLNT_CLIENTS; i++) {
-            if (_telnetClients[i] && _telnetClients[i].connected()) {
-                wsize = _telnetClients[i].write(buffer, size);
-                COMMANDS::wait(0);
+                log_info("Telnet client " << client.remoteIP().toString() << " rejected, all " << int(_sessions.size())
+                                          << " sessions are in use");
+                client.stop();
             }
         }
-        return wsize;
     }
 
-    void Telnet_Server::handle() {
-        COMMANDS::wait(0);
-        //check if can read
-        if (!_setupdone || _telnetserver == NULL) {
-            return;
-        }
-        clearClients();
-        //check clients for data
-        for (size_t i = 0; i < MAX_TLNT_CLIENTS; i++) {
-            if (_telnetClients[i] && _telnetClients[i].connected()) {
-                if (_telnetClientsIP[i] != _telnetClients[i].remoteIP()) {
-                    report_init_message(telnet_server);
-                    _telnetClientsIP[i] = _telnetClients[i].remoteIP();
-                }
-                if (_telnetClients[i].available()) {
-                    uint8_t buf[1024];
-                    COMMANDS::wait(0);
-                    int readlen  = _telnetClients[i].available();
-                    int writelen = TELNETRXBUFFERSIZE - available();
-                    if (readlen > 1024) {
-                        readlen = 1024;
-                    }
-                    if (readlen > writelen) {
-                        readlen = writelen;
+    // Waits for data on any connected session, then moves it into the
+    // session ring buffers.  The wait is bounded so that new connections
+    // are accepted promptly.
+    void Telnet_Server::service() {
+        fd_set readfds;
+        FD_ZERO(&readfds);
+        int maxfd = -1;
+        for (auto session : _sessions) {
+            if (session->connected()) {
+                int fd = session->_client->fd();
+                if (fd >= 0) {
+                    FD_SET(fd, &readfds);
+                    if (fd > maxfd) {
+                        maxfd = fd;
                     }
-                    if (readlen > 0) {
-                        _telnetClients[i].read(buf, readlen);
-                        push(buf, readlen);
-                    }
-                    return;
-                }
-            } else {
-                if (_telnetClients[i]) {
-                    _telnetClientsIP[i] = IPAddress(0, 0, 0, 0);
-                    _telnetClients[i].stop();
                 }
             }
-            COMMANDS::wait(0);
         }
-    }
 
-    int Telnet_Server::peek(void) {
-        if (_RXbufferSize > 0) {
-            return _RXbuffer[_RXbufferpos];
+        if (maxfd >= 0) {
+            timeval timeout = { 0, 20000 };
+            select(maxfd + 1, &readfds, NULL, NULL, &timeout);
         } else {
-            return -1;
+            vTaskDelay(20 / portTICK_PERIOD_MS);
         }
-    }
-
-    int Telnet_Server::available() { return _RXbufferSize; }
 
-    int Telnet_Server::get_rx_buffer_available() { return TELNETRXBUFFERSIZE - _RXbufferSize; }
-
-    bool Telnet_Server::push(uint8_t data) {
-        if ((1 + _RXbufferSize) <= TELNETRXBUFFERSIZE) {
-            int current = _RXbufferpos + _RXbufferSize;
-            if (current > TELNETRXBUFFERSIZE) {
-                current = current - TELNETRXBUFFERSIZE;
-            }
-            if (current > (TELNETRXBUFFERSIZE - 1)) {
-                current = 0;
+        // WiFiClient buffers internally, so every session is checked rather
+        // than only the ones that select() reported.
+        for (auto session : _sessions) {
+            if (session->connected()) {
+                session->receive();
+            } else {
+                session->detach();
             }
-            _RXbuffer[current] = data;
-            _RXbufferSize++;
-            return true;
         }
-        return false;
     }
 
-    bool Telnet_Server::push(const uint8_t* data, int data_size) {
-        if ((data_size + _RXbufferSize) <= TELNETRXBUFFERSIZE) {
-            int data_processed = 0;
-            int current        = _RXbufferpos + _RXbufferSize;
-            if (current > TELNETRXBUFFERSIZE) {
-                current = current - TELNETRXBUFFERSIZE;
+    void Telnet_Server::telnetTask(void* pvParameters) {
+        auto server = static_cast<Telnet_Server*>(pvParameters);
+        while (true) {
+            xSemaphoreTake(server->_lock, portMAX_DELAY);
+            bool running = _setupdone && _telnetserver;
+            if (running) {
+                server->acceptClients();
             }
-            for (int i = 0; i < data_size; i++) {
-                if (current > (TELNETRXBUFFERSIZE - 1)) {
-                    current = 0;
-                }
+            xSemaphoreGive(server->_lock);
 
-                _RXbuffer[current] = data[i];
-                current++;
-                data_processed++;
-
-                COMMANDS::wait(0);
-                //vTaskDelay(1 / portTICK_RATE_MS);  // Yield to other tasks
-            }
-            _RXbufferSize += data_processed;
-            return true;
-        }
-        return false;
-    }
-
-    int Telnet_Server::read(void) {
-        if (_RXbufferSize > 0) {
-            int v = _RXbuffer[_RXbufferpos];
-            _RXbufferpos++;
-            if (_RXbufferpos > (TELNETRXBUFFERSIZE - 1)) {
-                _RXbufferpos = 0;
+            if (running) {
+                server->service();
+            } else {
+                vTaskDelay(100 / portTICK_PERIOD_MS);
             }
-            _RXbufferSize--;
-            return v;
-        } else {
-            return -1;
         }
     }
 
@@ -4,7 +4,11 @@
 #pragma once
 
 #include "../Config.h"  // ENABLE_*
-#include <Stream.h>
+#include "../Transport.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include <vector>
 
 #ifdef ENABLE_WIFI
 
@@ -12,29 +16,55 @@ class WiFiServer;
 class WiFiClient;
 
 namespace WebUI {
-    class Telnet_Server : public Stream {
-        //how many clients should be able to telnet to this ESP32
-        static const int MAX_TLNT_CLIENTS = 1;
-
-        static const int TELNETRXBUFFERSIZE = 1200;
-        static const int FLUSHTIMEOUT       = 500;
-
+    // One telnet connection, registered as its own input client.  The telnet
+    // task moves received bytes into the receive ring and pollClients() reads
+    // them out; with a single producer and a single consumer the ring needs
+    // no lock.  Output comes from the client's output queue task.
+    class Telnet_Session : public Transport {
     public:
-        Telnet_Server();
+        static const int RXBUFFERSIZE = 1200;
+
+        Telnet_Session();
 
-        bool   begin();
-        void   end();
-        void   handle();
         size_t write(uint8_t data) override;
-        size_t write(const uint8_t* buffer, size_t size);
-        int    read(void);
-        int    peek(void);
-        int    available();
-        int    get_rx_buffer_available();
-        bool   push(uint8_t data);
-        bool   push(const uint8_t* data, int datasize);
+        size_t write(const uint8_t* buffer, size_t size) override;
+        int    read(void) override;
+        size_t read(uint8_t* buffer, size_t length) override;
+        int    peek(void) override;
+        int    available() override;
         void   flush() override {}
 
+        bool connected();
+
+        ~Telnet_Session();
+
+    private:
+        friend class Telnet_Server;
+
+        WiFiClient*       _client;
+        SemaphoreHandle_t _lock;  // Guards _client between the telnet and output tasks
+
+        uint8_t           _RXbuffer[RXBUFFERSIZE];
+        volatile uint16_t _RXhead;  // Written only by the telnet task
+        volatile uint16_t _RXtail;  // Written only by pollClients()
+
+        int    rxSpace() const;
+        void   attach(WiFiClient& client);
+        void   detach();
+        size_t receive();
+    };
+
+    class Telnet_Server {
+    public:
+                Telnet_Server();
+
+        bool begin();
+        void end();
+
+        // The sessions, created on first use with the number of clients set
+        // by Telnet/MaxClients.  Changing that setting takes effect on restart.
+        const std::vector<Telnet_Session*>& sessions();
+
         static uint16_t port() { return _port; }
 
         ~Telnet_Server();
@@ -42,16 +72,15 @@ namespace WebUI {
     private:
         static bool        _setupdone;
         static WiFiServer* _telnetserver;
-        static WiFiClient  _telnetClients[MAX_TLNT_CLIENTS];
-        static IPAddress   _telnetClientsIP[MAX_TLNT_CLIENTS];
         static uint16_t    _port;
 
-        void clearClients();
+        std::vector<Telnet_Session*> _sessions;
+        SemaphoreHandle_t            _lock;  // Guards _telnetserver against end()
+        TaskHandle_t                 _task;
 
-        uint32_t _lastflush;
-        uint8_t  _RXbuffer[TELNETRXBUFFERSIZE];
-        uint16_t _RXbufferSize;
-        uint16_t _RXbufferpos;
+        void        acceptClients();
+        void        service();
+        static void telnetTask(void* pvParameters);
     };
 
     extern Telnet_Server telnet_server;
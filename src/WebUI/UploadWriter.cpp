@@ -0,0 +1,182 @@
+// Copyright (c) 2021 -  FluidNC contributors
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#include "UploadWriter.h"
+
+#ifdef ENABLE_WIFI
+
+#    include "../Logging.h"
+#    include "../SDCard.h"  // getSPISemaphore()
+
+#    include <Arduino.h>
+#    include <FS.h>
+
+namespace WebUI {
+    UploadWriter upload_writer;
+
+    static const uint32_t reportInterval = 1024 * 1024;  // bytes
+
+    bool UploadWriter::begin(fs::File* file, bool useSPI) {
+        abort();  // In case an earlier upload was never finished
+        if (!_task) {
+            _full = xQueueCreate(2, sizeof(Block));
+            _free = xQueueCreate(2, sizeof(uint8_t*));
+            xTaskCreatePinnedToCore(writerTask,      // task
+                                    "uploadWriter",  // name for task
+                                    4096,            // size of task stack
+                                    this,            // parameters
+                                    1,               // priority
+                                    &_task,
+                                    SUPPORT_TASK_CORE  // core
+            );
+        }
+
+        _buffers = static_cast<uint8_t*>(malloc(2 * blockSize));
+        if (!_buffers) {
+            log_info("Upload error - no memory for write buffers");
+            return false;
+        }
+        xQueueReset(_full);
+        xQueueReset(_free);
+        uint8_t* spare = _buffers + blockSize;
+        xQueueSend(_free, &spare, 0);
+
+        _current        = _buffers;
+        _fill           = 0;
+        _file           = file;
+        _useSPI         = useSPI;
+        _failed         = false;
+        _written        = 0;
+        _startMs        = millis();
+        _nextReport     = reportInterval;
+        _longestStallUs = 0;
+        _longestWriteUs = 0;
+        return true;
+    }
+
+    // Hands the current block to the task and waits for the other buffer.
+    // The wait is how long the card holds up the web services.
+    void UploadWriter::submit() {
+        Block block = { _current, _fill };
+        xQueueSend(_full, &block, portMAX_DELAY);
+
+        uint32_t start = micros();
+        xQueueReceive(_free, &_current, portMAX_DELAY);
+        uint32_t stall = micros() - start;
+        if (stall > _longestStallUs) {
+            _longestStallUs = stall;
+        }
+        _fill = 0;
+    }
+
+    // Waits until the task has finished with the block it holds, if any
+    void UploadWriter::drain() {
+        uint8_t* other;
+        xQueueReceive(_free, &other, portMAX_DELAY);
+        xQueueSend(_free, &other, 0);
+    }
+
+    void UploadWriter::report(const char* what) {
+        uint32_t ms = millis() - _startMs;
+        log_info(what << " " << _written << " bytes, " << (ms ? _written / ms : 0) << " KB/s, longest stall "
+                      << _longestStallUs / 1000 << " ms, longest block write " << _longestWriteUs / 1000 << " ms");
+    }
+
+    bool UploadWriter::write(const uint8_t* data, size_t len) {
+        while (len) {
+            if (_failed) {
+                return false;
+            }
+            size_t n = blockSize - _fill;
+            if (n > len) {
+                n = len;
+            }
+            memcpy(_current + _fill, data, n);
+            _fill += n;
+            data += n;
+            len -= n;
+            if (_fill == blockSize) {
+                submit();
+            }
+        }
+        if (_written >= _nextReport) {
+            _nextReport += reportInterval;
+            report("Upload");
+        }
+        return !_failed;
+    }
+
+    bool UploadWriter::finish() {
+        if (!_buffers) {
+            return false;
+        }
+        if (_fill && !_failed) {
+            submit();
+        }
+        drain();
+        report("Upload wrote");
+        free(_buffers);
+        _buffers = nullptr;
+        return !_failed;
+    }
+
+    void UploadWriter::abort() {
+        if (!_buffers) {
+            return;
+        }
+        _failed = true;  // The task skips anything still queued
+        drain();
+        free(_buffers);
+        _buffers = nullptr;
+    }
+
+    void UploadWriter::writeBlock(const Block& block) {
+        if (_useSPI) {
+            while (!getSPISemaphore()) {}
+        }
+
+        uint32_t start    = micros();
+        size_t   position = _file->position();
+        size_t   written  = _file->write(block.data, block.len);
+        for (int i = 0; written != block.len && i < retries; i++) {
+            log_info("Upload write at " << position << " failed expected " << block.len << " got " << written << ", retry "
+                                        << (i + 1));
+            vTaskDelay(100 / portTICK_PERIOD_MS);
+            if (!_file->seek(position)) {
+                log_info("seek failed, aborting retry");
+                break;
+            }
+            written = _file->write(block.data, block.len);
+        }
+        uint32_t elapsed = micros() - start;
+
+        if (_useSPI) {
+            releaseSPISemaphore();
+        }
+
+        if (elapsed > _longestWriteUs) {
+            _longestWriteUs = elapsed;
+        }
+        if (written == block.len) {
+            _written += written;
+        } else {
+            _failed = true;
+        }
+    }
+
+    void UploadWriter::writerTask(void* pvParameters) {
+        auto  writer = static_cast<UploadWriter*>(pvParameters);
+        Block block;
+        while (true) {
+            if (xQueueReceive(writer->_full, &block, portMAX_DELAY) != pdTRUE) {
+                continue;
+            }
+            if (!writer->_failed) {
+                writer->writeBlock(block);
+            }
+            xQueueSend(writer->_free, &block.data, 0);
+        }
+    }
+}
+
+#endif
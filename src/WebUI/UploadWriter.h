@@ -0,0 +1,80 @@
+// Copyright (c) 2021 -  FluidNC contributors
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#pragma once
+
+#include "../Config.h"  // ENABLE_*
+
+#ifdef ENABLE_WIFI
+
+#    include <cstddef>
+#    include <cstdint>
+#    include <freertos/FreeRTOS.h>
+#    include <freertos/queue.h>
+#    include <freertos/task.h>
+
+namespace fs {
+    class File;
+}
+
+namespace WebUI {
+    // Writes an uploaded file from a task of its own.  The web server copies
+    // each HTTP chunk into one of two block buffers and goes back to
+    // receiving while the task writes the other block, so the network and
+    // the card are busy at the same time.  Blocks are a whole number of SD
+    // sectors, so only the last write of a file can be a partial sector.
+    class UploadWriter {
+    public:
+        static const size_t blockSize = 8 * 512;
+        static const int    retries   = 5;
+
+        // useSPI takes the SPI bus semaphore around each block write, for SD
+        bool begin(fs::File* file, bool useSPI);
+
+        // Returns false once a block write has failed
+        bool write(const uint8_t* data, size_t len);
+
+        // Writes the partial last block and waits until everything is on the
+        // card.  Must not be called with the SPI semaphore held.
+        bool finish();
+
+        // Discards unwritten data and waits for the task to go idle
+        void abort();
+
+        bool active() const { return _buffers != nullptr; }
+
+    private:
+        struct Block {
+            uint8_t* data;
+            size_t   len;
+        };
+
+        QueueHandle_t _full  = nullptr;  // Blocks waiting to be written
+        QueueHandle_t _free  = nullptr;  // Buffers the task has finished with
+        TaskHandle_t  _task  = nullptr;
+        fs::File*     _file  = nullptr;
+        bool          _useSPI;
+        volatile bool _failed;
+
+        uint8_t* _buffers = nullptr;
+        uint8_t* _current;  // The block being filled by write()
+        size_t   _fill;
+
+        // Statistics, reported as the upload progresses
+        volatile uint32_t _written;
+        uint32_t          _startMs;
+        uint32_t          _nextReport;
+        uint32_t          _longestStallUs;  // Longest wait in write() for a free buffer
+        volatile uint32_t _longestWriteUs;  // Longest block write, including retries
+
+        void        submit();
+        void        drain();
+        void        report(const char* what);
+        void        writeBlock(const Block& block);
+        static void writerTask(void* pvParameters);
+    };
+
+    extern UploadWriter upload_writer;
+}
+
+#endif
@@ -12,6 +12,8 @@
 #    include "WifiConfig.h"  // wifi_config
 
 #    include "Serial2Socket.h"
+#    include "UploadWriter.h"
+#    include "JobStream.h"
 #    include "WebServer.h"
 #    include "../SDCard.h"
 
@@ -94,13 +96,15 @@ namespace WebUI {
 
         //create instance
         _webserver = new WebServer(_port);
-#    ifdef ENABLE_AUTHENTICATION
         //here the list of headers to be recorded
-        const char* headerkeys[]   = { "Cookie" };
-        size_t      headerkeyssize = sizeof(headerkeys) / sizeof(char*);
+#    ifdef ENABLE_AUTHENTICATION
+        const char* headerkeys[] = { "Cookie", "If-None-Match", "If-Modified-Since", "Range" };
+#    else
+        const char* headerkeys[] = { "If-None-Match", "If-Modified-Since", "Range" };
+#    endif
+        size_t headerkeyssize = sizeof(headerkeys) / sizeof(char*);
         //ask server to track these headers
         _webserver->collectHeaders(headerkeys, headerkeyssize);
-#    endif
         _socket_server = new WebSocketsServer(_port + 1);
         _socket_server->begin();
         _socket_server->onEvent(handle_Websocket_Event);
@@ -216,6 +220,229 @@ namespace WebUI {
 #    endif
     }
 
+    //Commands on the main loop/////////////////////////////////////////////
+
+    // Settings and machine state belong to the main loop, so [ESP] commands
+    // are handed to it and the web task waits for the result.  The reply is
+    // written to the HTTP client by the main loop while the web task waits.
+    struct WebCommandRequest {
+        char*               line;
+        Print*              out;
+        AuthenticationLevel auth_level;
+        Error               result;
+        TaskHandle_t        waiter;
+    };
+
+    static QueueHandle_t commandQueue   = NULL;
+    static volatile bool commandRunning = false;
+
+    static Error execute_on_main_loop(char* line, Print& out, AuthenticationLevel auth_level) {
+        WebCommandRequest  request  = { line, &out, auth_level, Error::Ok, xTaskGetCurrentTaskHandle() };
+        WebCommandRequest* pRequest = &request;
+        if (!commandQueue) {
+            commandQueue = xQueueCreate(1, sizeof(WebCommandRequest*));
+        }
+        xQueueSend(commandQueue, &pRequest, portMAX_DELAY);
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        return request.result;
+    }
+
+    void Web_Server::run_commands() {
+        WebCommandRequest* request;
+        if (!commandQueue) {
+            return;
+        }
+        while (xQueueReceive(commandQueue, &request, 0) == pdTRUE) {
+            commandRunning  = true;
+            request->result = settings_execute_line(request->line, *request->out, request->auth_level);
+            commandRunning  = false;
+            xTaskNotifyGive(request->waiter);
+        }
+    }
+
+    bool Web_Server::runningCommand() { return commandRunning; }
+
+    bool Web_Server::active() {
+        return _upload_status == UploadStatusType::ONGOING || (_webserver && _webserver->client().connected());
+    }
+
+    //Caching and ranges////////////////////////////////////////////////////
+
+    // Strong validators for SPIFFS files.  The tag is a hash of the file
+    // content, and hashing reads the whole file, so tags are remembered
+    // until the file changes size or the file list is modified.
+    struct ETagEntry {
+        String   path;
+        size_t   size;
+        time_t   lastWrite;
+        uint32_t hash;
+    };
+    static const int ETAG_CACHE_SIZE = 8;
+    static ETagEntry etagCache[ETAG_CACHE_SIZE];
+    static int       etagNext = 0;
+
+    static void forgetETags() {
+        for (auto& entry : etagCache) {
+            entry.path = "";
+        }
+    }
+
+    static String fileETag(File& file, const String& path) {
+        size_t     size      = file.size();
+        time_t     lastWrite = file.getLastWrite();
+        uint32_t   hash      = 0;
+        ETagEntry* found     = nullptr;
+        for (auto& entry : etagCache) {
+            if (entry.path == path && entry.size == size && entry.lastWrite == lastWrite) {
+                found = &entry;
+                break;
+            }
+        }
+        if (found) {
+            hash = found->hash;
+        } else {
+            // FNV-1a
+            hash = 2166136261u;
+            uint8_t buf[512];
+            int     n;
+            while ((n = file.read(buf, sizeof(buf))) > 0) {
+                for (int i = 0; i < n; i++) {
+                    hash = (hash ^ buf[i]) * 16777619u;
+                }
+            }
+            file.seek(0);
+            etagCache[etagNext] = { path, size, lastWrite, hash };
+            etagNext            = (etagNext + 1) % ETAG_CACHE_SIZE;
+        }
+        char tag[24];
+        snprintf(tag, sizeof(tag), "\"%08x-%x\"", unsigned(hash), unsigned(size));
+        return tag;
+    }
+
+    // Empty if the file was written before the clock was set
+    static String httpDate(time_t t) {
+        if (t < 1577836800) {  // 2020-01-01
+            return "";
+        }
+        struct tm tm;
+        char      buf[32];
+        gmtime_r(&t, &tm);
+        strftime(buf, sizeof(buf), "%a, %d %b %Y %H:%M:%S GMT", &tm);
+        return buf;
+    }
+
+    // Parses a single "bytes=first-last" range, including the open-ended
+    // "first-" and the suffix "-count" forms.
+    static bool parseRange(String range, size_t size, size_t& first, size_t& last) {
+        if (!range.startsWith("bytes=") || size == 0) {
+            return false;
+        }
+        range    = range.substring(6);
+        int dash = range.indexOf('-');
+        if (dash < 0) {
+            return false;
+        }
+        String from = range.substring(0, dash);
+        String to   = range.substring(dash + 1);
+        from.trim();
+        to.trim();
+        if (from.length() == 0) {
+            long count = to.toInt();
+            if (count <= 0) {
+                return false;
+            }
+            first = size_t(count) >= size ? 0 : size - count;
+            last  = size - 1;
+            return true;
+        }
+        first = from.toInt();
+        last  = to.length() ? to.toInt() : size - 1;
+        if (last >= size) {
+            last = size - 1;
+        }
+        return first <= last;
+    }
+
+    // Browsers revalidate with If-None-Match on every load and get a 304
+    // unless the file has changed.
+    void Web_Server::streamSPIFFSFile(const String& path, const String& contentType) {
+        File   file         = SPIFFS.open(path, FILE_READ);
+        String etag         = fileETag(file, path);
+        String lastModified = httpDate(file.getLastWrite());
+
+        _webserver->sendHeader("Cache-Control", "no-cache");
+        _webserver->sendHeader("ETag", etag);
+        if (lastModified.length()) {
+            _webserver->sendHeader("Last-Modified", lastModified);
+        }
+
+        bool fresh;
+        if (_webserver->hasHeader("If-None-Match")) {
+            fresh = _webserver->header("If-None-Match").indexOf(etag) >= 0;
+        } else {
+            fresh = lastModified.length() && _webserver->header("If-Modified-Since") == lastModified;
+        }
+        if (fresh) {
+            _webserver->send(304);
+        } else {
+            _webserver->streamFile(file, contentType);
+        }
+        file.close();
+    }
+
+    // Serves an SD file, or the part of it asked for by a Range header, in
+    // sector-sized reads.  The SPI semaphore is held only for each read.
+    bool Web_Server::streamSDFile(const String& path, const String& contentType) {
+        File datafile = SD.open(path);
+        if (!datafile) {
+            return false;
+        }
+        size_t size  = datafile.size();
+        size_t first = 0;
+        size_t last  = size - 1;
+        int    code  = 200;
+
+        _webserver->sendHeader("Accept-Ranges", "bytes");
+        _webserver->sendHeader("Cache-Control", "no-cache");
+        if (path.endsWith(".gz") && contentType != "application/x-gzip") {
+            _webserver->sendHeader("Content-Encoding", "gzip");
+        }
+
+        // Multiple ranges are answered with the whole file
+        String range = _webserver->header("Range");
+        if (range.length() && range.indexOf(',') < 0) {
+            if (!parseRange(range, size, first, last)) {
+                _webserver->sendHeader("Content-Range", "bytes */" + String(size));
+                _webserver->send(416, "text/plain", "");
+                datafile.close();
+                return true;
+            }
+            code = 206;
+            _webserver->sendHeader("Content-Range", "bytes " + String(first) + "-" + String(last) + "/" + String(size));
+        }
+
+        size_t remaining = size ? last - first + 1 : 0;
+        _webserver->setContentLength(remaining);
+        _webserver->send(code, contentType, "");
+
+        if (first && !datafile.seek(first)) {
+            remaining = 0;
+        }
+        uint8_t buf[4 * 512];
+        while (remaining) {
+            size_t want = remaining < sizeof(buf) ? remaining : sizeof(buf);
+            while (!getSPISemaphore()) {}
+            int got = datafile.read(buf, want);
+            releaseSPISemaphore();
+            if (got <= 0 || _webserver->client().write(buf, got) != size_t(got)) {
+                break;
+            }
+            remaining -= got;
+        }
+        datafile.close();
+        return true;
+    }
+
     //Root of Webserver/////////////////////////////////////////////////////
 
     void Web_Server::handle_root() {
@@ -229,9 +456,7 @@ namespace WebUI {
                 path = pathWithGz;
             }
 
-            File file = SPIFFS.open(path, FILE_READ);
-            _webserver->streamFile(file, contentType);
-            file.close();
+            streamSPIFFSFile(path, contentType);
             return;
         }
 
@@ -262,43 +487,18 @@ namespace WebUI {
                 content += path + ", SD is not available.";
 
                 _webserver->send(500, "text/plain", content);
+                return;
             }
             if (SD.exists(pathWithGz) || SD.exists(path)) {
                 if (SD.exists(pathWithGz)) {
                     path = pathWithGz;
                 }
-                File datafile = SD.open(path);
-                if (datafile) {
-                    vTaskDelay(1 / portTICK_RATE_MS);
-                    size_t totalFileSize = datafile.size();
-                    size_t i             = 0;
-                    bool   done          = false;
-                    _webserver->setContentLength(totalFileSize);
-                    _webserver->send(200, contentType, "");
-                    uint8_t buf[1024];
-                    while (!done) {
-                        vTaskDelay(1 / portTICK_RATE_MS);
-                        int v = datafile.read(buf, 1024);
-                        if ((v == -1) || (v == 0)) {
-                            done = true;
-                        } else {
-                            _webserver->client().write(buf, 1024);
-                            i += v;
-                        }
-
-                        if (i >= totalFileSize) {
-                            done = true;
-                        }
-                    }
-                    datafile.close();
-                    if (i != totalFileSize) {
-                        //error: TBD
-                    }
+                if (streamSDFile(path, contentType)) {
                     sdCard->end();
                     return;
                 }
-                sdCard->end();
             }
+            sdCard->end();
             String content = "cannot find ";
             content += path;
             _webserver->send(404, "text/plain", content);
@@ -307,9 +507,7 @@ namespace WebUI {
             if (SPIFFS.exists(pathWithGz)) {
                 path = pathWithGz;
             }
-            File file = SPIFFS.open(path, FILE_READ);
-            _webserver->streamFile(file, contentType);
-            file.close();
+            streamSPIFFSFile(path, contentType);
             return;
         } else {
             page_not_found = true;
@@ -437,7 +635,7 @@ namespace WebUI {
             char line[256];
             strncpy(line, cmd.c_str(), 255);
             WebClient* webresponse = new WebClient(_webserver, silent);
-            Error      err         = settings_execute_line(line, *webresponse, auth_level);
+            Error      err         = execute_on_main_loop(line, *webresponse, auth_level);
             String     answer;
             if (err == Error::Ok) {
                 answer = "ok";
@@ -697,6 +895,7 @@ namespace WebUI {
 
         //check if query need some action
         if (_webserver->hasArg("action")) {
+            forgetETags();
             //delete a file
             if (_webserver->arg("action") == "delete" && _webserver->hasArg("filename")) {
                 String filename;
@@ -863,14 +1062,18 @@ namespace WebUI {
         if (_socket_server && st) {
             String s = "ERROR:" + String(code) + ":";
             s += st;
+            Serial2Socket.lock();
             _socket_server->sendTXT(_id_connection, s);
+            Serial2Socket.unlock();
             if (web_error != 0 && _webserver && _webserver->client().available() > 0) {
                 _webserver->send(web_error, "text/xml", st);
             }
 
             uint32_t start_time = millis();
             while ((millis() - start_time) < timeout) {
+                Serial2Socket.lock();
                 _socket_server->loop();
+                Serial2Socket.unlock();
                 delay(10);
             }
         }
@@ -905,6 +1108,7 @@ namespace WebUI {
                 //Upload start
                 //**************
                 if (upload.status == UPLOAD_FILE_START) {
+                    forgetETags();
                     _upload_status         = UploadStatusType::ONGOING;
                     String upload_filename = upload.filename;
                     if (upload_filename[0] != '/') {
@@ -941,7 +1145,7 @@ namespace WebUI {
                         //create file
                         fsUploadFile = SPIFFS.open(filename, FILE_WRITE);
                         //check If creation succeed
-                        if (fsUploadFile) {
+                        if (fsUploadFile && upload_writer.begin(&fsUploadFile, false)) {
                             //if yes upload is started
                             _upload_status = UploadStatusType::ONGOING;
                         } else {
@@ -954,11 +1158,10 @@ namespace WebUI {
                     //Upload write
                     //**************
                 } else if (upload.status == UPLOAD_FILE_WRITE) {
-                    vTaskDelay(1 / portTICK_RATE_MS);
                     //check if file is available and no error
                     if (fsUploadFile && _upload_status == UploadStatusType::ONGOING) {
-                        //no error so write post date
-                        if (upload.currentSize != fsUploadFile.write(upload.buf, upload.currentSize)) {
+                        //no error so hand the data to the writer task
+                        if (!upload_writer.write(upload.buf, upload.currentSize)) {
                             _upload_status = UploadStatusType::FAILED;
                             log_info("Upload error");
                             pushError(ESP_ERROR_FILE_WRITE, "File write failed");
@@ -974,7 +1177,10 @@ namespace WebUI {
                 } else if (upload.status == UPLOAD_FILE_END) {
                     //check if file is still open
                     if (fsUploadFile) {
-                        //close it
+                        //wait for the last blocks, then close it
+                        if (!upload_writer.finish()) {
+                            _upload_status = UploadStatusType::FAILED;
+                        }
                         fsUploadFile.close();
                         //check size
                         String sizeargname = upload.filename + "S";
@@ -1002,6 +1208,7 @@ namespace WebUI {
                     //**************
                 } else {
                     _upload_status = UploadStatusType::FAILED;
+                    upload_writer.abort();
                     //pushError(ESP_ERROR_UPLOAD, "File upload failed");
                     return;
                 }
@@ -1009,6 +1216,7 @@ namespace WebUI {
         }
 
         if (_upload_status == UploadStatusType::FAILED) {
+            upload_writer.abort();
             cancelUpload();
             if (SPIFFS.exists(filename)) {
                 SPIFFS.remove(filename);
@@ -1415,6 +1623,53 @@ namespace WebUI {
             }
         #endif
 
+        HTTPUpload& upload = _webserver->upload();
+
+        // Chunks are only copied into the upload writer, whose task takes
+        // the SPI semaphore for each block it writes to the card.
+
+        if (upload.status == UPLOAD_FILE_WRITE)
+        {
+            if (_upload_status == UploadStatusType::ONGOING)
+            {
+                // calculate checksum
+
+                const uint8_t *bp = (const uint8_t *) upload.buf;
+                for (int j=0; j<upload.currentSize; j++)
+                {
+                    _adler_a = (_adler_a + bp[j]) % MOD_ADLER;
+                    _adler_b = (_adler_b + _adler_a) % MOD_ADLER;
+                }
+
+                if (!upload_writer.write(upload.buf, upload.currentSize))
+                {
+                    _upload_status = UploadStatusType::FAILED;
+                    pushError(ESP_ERROR_FILE_WRITE, "File write failed");
+                }
+            }
+            if (_upload_status != UploadStatusType::FAILED)
+                return;
+        }
+
+        // Everything else needs the card, so the writer must first be
+        // done with the blocks it holds.
+
+        if (upload_writer.active())
+        {
+            if (upload.status == UPLOAD_FILE_END && _upload_status == UploadStatusType::ONGOING)
+            {
+                if (!upload_writer.finish())
+                {
+                    _upload_status = UploadStatusType::FAILED;
+                    pushError(ESP_ERROR_FILE_WRITE, "File write failed");
+                }
+            }
+            else
+            {
+                upload_writer.abort();
+            }
+        }
+
         // Initial 'proof' of SPI Semaphore. The webserver simply waits here
         // to get the SPI (sdcard) semaphore with a built in delay of 1 tick (10 ms).
 
@@ -1432,7 +1687,6 @@ namespace WebUI {
             //Upload start
             //**************
 
-            HTTPUpload& upload = _webserver->upload();
             if ((_upload_status != UploadStatusType::FAILED) || (upload.status == UPLOAD_FILE_START))
             {
                 if (upload.status == UPLOAD_FILE_START)
@@ -1508,7 +1762,7 @@ namespace WebUI {
                         if (_upload_status != UploadStatusType::FAILED)
                         {
                             sdUploadFile = SD.open(filename, FILE_WRITE);
-                            if (!sdUploadFile)
+                            if (!sdUploadFile || !upload_writer.begin(&sdUploadFile, true))
                             {
                                 _upload_status = UploadStatusType::FAILED;
                                 log_info("Upload error - File creation failed");
@@ -1522,82 +1776,6 @@ namespace WebUI {
                     }
                 }
 
-                // Upload write
-                //**************
-
-                else if (upload.status == UPLOAD_FILE_WRITE)
-                {
-                    // vTaskDelay(20 / portTICK_RATE_MS);
-
-                    // auto sdCard = config->_sdCard;
-                    // if (sdUploadFile && (_upload_status == UploadStatusType::ONGOING) &&
-                    //     (sdCard->get_state() == SDState::BusyUploading))
-                    {
-                        // log_debug("upload(" << upload.currentSize << " at " << position);
-
-                        // calculate checksum
-
-                        const uint8_t *bp = (const uint8_t *) upload.buf;
-                        for (int j=0; j<upload.currentSize; j++)
-                        {
-                            _adler_a = (_adler_a + bp[j]) % MOD_ADLER;
-                            _adler_b = (_adler_b + _adler_a) % MOD_ADLER;
-                        }
-
-                        int u_try = 0;
-                        #define UPLOAD_RETRIES  5
-                        uint32_t position = sdUploadFile.position();
-                        vTaskDelay(10 / portTICK_PERIOD_MS);
-
-RETRY_UPLOAD:
-
-                        size_t written = sdUploadFile.write(upload.buf, upload.currentSize);
-                        if (written != upload.currentSize)
-                        {
-                            log_info("Upload write at " << position << " failed expected " << upload.currentSize << " got " << written);
-                            if (u_try < UPLOAD_RETRIES)
-                            {
-                                u_try++;
-                                log_info("--- >retry upload(" << u_try << ")");
-                                sdUploadFile.close();
-                                vTaskDelay(200 / portTICK_PERIOD_MS);
-                                sdUploadFile = SD.open(filename, FILE_WRITE);
-                                if (!sdUploadFile)
-                                {
-                                    log_info("Could not re-open file for writing");
-                                }
-                                else
-                                {
-                                    vTaskDelay(200 / portTICK_PERIOD_MS);
-                                    if (!sdUploadFile.seek(position))
-                                    {
-                                        log_info("seek failed, aborting retry");
-                                    }
-                                    else
-                                    {
-                                        vTaskDelay(100 / portTICK_PERIOD_MS);
-                                        goto RETRY_UPLOAD;
-                                    }
-                                }
-                            }
-
-                            _upload_status = UploadStatusType::FAILED;
-                            pushError(ESP_ERROR_FILE_WRITE, "File write failed");
-                        }
-                        else
-                        {
-                            upload.currentSize = written;
-                        }
-                    }
-                    // else
-                    // {
-                    //     //if error set flag UploadStatusType::FAILED
-                    //     _upload_status = UploadStatusType::FAILED;
-                    //     log_info("Upload failed");
-                    //     pushError(ESP_ERROR_FILE_WRITE, "File write failed");
-                    // }
-                }
-
                 //Upload end
                 //**************
 
@@ -1771,6 +1949,9 @@ RETRY_UPLOAD:
         if (_webserver) {
             _webserver->handleClient();
         }
+        // The websocket server is shared with the output queue task that
+        // writes to Serial2Socket
+        Serial2Socket.lock();
         if (_socket_server && _setupdone) {
             _socket_server->loop();
         }
@@ -1780,11 +1961,15 @@ RETRY_UPLOAD:
             _socket_server->broadcastTXT(s);
             start_time = millis();
         }
+        Serial2Socket.handle_flush();
+        jobStream.report(_socket_server);
+        Serial2Socket.unlock();
     }
 
     void Web_Server::handle_Websocket_Event(uint8_t num, uint8_t type, uint8_t* payload, size_t length) {
         switch (type) {
             case WStype_DISCONNECTED:
+                jobStream.disconnected(num);
                 break;
             case WStype_CONNECTED: {
                 IPAddress ip = _socket_server->remoteIP(num);
@@ -1795,18 +1980,27 @@ RETRY_UPLOAD:
                 s = "ACTIVE_ID:" + String(_id_connection);
                 _socket_server->broadcastTXT(s);
             } break;
-            case WStype_TEXT:
-                // send message to client
-                // webSocket.sendTXT(num, "message here");
-
-                // send data to all connected clients
-                // webSocket.broadcastTXT("message here");
-                break;
+            case WStype_TEXT: {
+                // The library terminates text payloads
+                const char* text = reinterpret_cast<const char*>(payload);
+                if (strncmp(text, "JOB:", 4) != 0) {
+                    break;
+                }
+#    ifdef ENABLE_AUTHENTICATION
+                // JOB:START:<ESPSESSIONID>, from a session that may send commands
+                if (strncmp(text, "JOB:START", 9) == 0) {
+                    const char*       sessionID = text[9] == ':' ? text + 10 : "";
+                    AuthenticationIP* auth      = GetAuth(_socket_server->remoteIP(num), sessionID);
+                    if (!auth || auth->level == AuthenticationLevel::LEVEL_GUEST) {
+                        _socket_server->sendTXT(num, "JOB:ERROR:AUTH");
+                        break;
+                    }
+                }
+#    endif
+                jobStream.handleText(_socket_server, num, text);
+            } break;
             case WStype_BIN:
-                //hexdump(payload, length);
-
-                // send message to client
-                // webSocket.sendBIN(num, payload, length);
+                jobStream.handleBinary(_socket_server, num, payload, length);
                 break;
             default:
                 break;
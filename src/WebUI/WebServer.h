@@ -39,6 +39,14 @@ namespace WebUI {
         static long     get_client_ID();
         static uint16_t port() { return _port; }
 
+        // True while an HTTP client is connected or an upload is running
+        static bool active();
+
+        // Runs [ESP] commands received by the web task.  Called from the
+        // main loop, since commands change settings and machine state.
+        static void run_commands();
+        static bool runningCommand();
+
         ~Web_Server();
 
     private:
@@ -77,6 +85,8 @@ namespace WebUI {
         static void handle_direct_SDFileList();
         static void SDFile_direct_upload();
         static bool deleteRecursive(String path);
+        static void streamSPIFFSFile(const String& path, const String& contentType);
+        static bool streamSDFile(const String& path, const String& contentType);
     };
 
     extern Web_Server web_server;
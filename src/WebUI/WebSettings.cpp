@@ -69,6 +69,7 @@ namespace WebUI {
     IntSetting*    http_port;
     EnumSetting*   telnet_enable;
     IntSetting*    telnet_port;
+    IntSetting*    telnet_max_clients;
 
     enum_opt_t staModeOptions = {
         { "DHCP", DHCP_MODE },
@@ -1080,6 +1081,8 @@ namespace WebUI {
         telnet_port = new IntSetting(
             "Telnet Port", WEBSET, WA, "ESP131", "Telnet/Port", DEFAULT_TELNETSERVER_PORT, MIN_TELNET_PORT, MAX_TELNET_PORT, NULL);
         telnet_enable = new EnumSetting("Telnet Enable", WEBSET, WA, "ESP130", "Telnet/Enable", DEFAULT_TELNET_STATE, &onoffOptions, NULL);
+        telnet_max_clients = new IntSetting(
+            "Telnet Clients", WEBSET, WA, NULL, "Telnet/MaxClients", DEFAULT_TELNET_CLIENTS, MIN_TELNET_CLIENTS, MAX_TELNET_CLIENTS, NULL);
 
         http_port =
             new IntSetting("HTTP Port", WEBSET, WA, "ESP121", "HTTP/Port", DEFAULT_WEBSERVER_PORT, MIN_HTTP_PORT, MAX_HTTP_PORT, NULL);
@@ -40,6 +40,7 @@ namespace WebUI {
     extern IntSetting*    http_port;
     extern EnumSetting*   telnet_enable;
     extern IntSetting*    telnet_port;
+    extern IntSetting*    telnet_max_clients;
 
     extern StringSetting* wifi_sta_password;
     extern StringSetting* wifi_ap_password;
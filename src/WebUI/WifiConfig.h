@@ -56,6 +56,7 @@ namespace WebUI {
     static const int   DEFAULT_HTTP_STATE        = 1;
     static const int   DEFAULT_TELNETSERVER_PORT = 23;
     static const int   DEFAULT_TELNET_STATE      = 1;
+    static const int   DEFAULT_TELNET_CLIENTS    = 2;
     static const int   DEFAULT_STA_IP_MODE       = DHCP_MODE;
     static const char* HIDDEN_PASSWORD           = "********";
     static const char* DEFAULT_TOKEN             = "";
@@ -74,6 +75,8 @@ namespace WebUI {
     static const int MIN_HTTP_PORT                   = 1;
     static const int MAX_TELNET_PORT                 = 65001;
     static const int MIN_TELNET_PORT                 = 1;
+    static const int MAX_TELNET_CLIENTS              = 4;
+    static const int MIN_TELNET_CLIENTS              = 1;
     static const int MIN_CHANNEL                     = 1;
     static const int MAX_CHANNEL                     = 14;
     static const int MIN_NOTIFICATION_TOKEN_LENGTH   = 0;
@@ -23,9 +23,36 @@
 namespace WebUI {
     WiFiServices wifi_services;
 
+    volatile bool     WiFiServices::_running      = false;
+    volatile bool     WiFiServices::_inHandle     = false;
+    volatile uint32_t WiFiServices::_lastActivity = 0;
+
+    static TaskHandle_t servicesTaskHandle = nullptr;
+
+    // How long after the last HTTP activity busy() stays true
+    static const uint32_t activityHoldMs = 1000;
+
     WiFiServices::WiFiServices() {}
     WiFiServices::~WiFiServices() { end(); }
 
+    void WiFiServices::servicesTask(void* pvParameters) {
+        while (true) {
+            // _inHandle is set before _running is checked, so end() either
+            // sees the pass in progress or this pass sees _running cleared
+            _inHandle = true;
+            if (_running) {
+                handle();
+                if (Web_Server::active()) {
+                    _lastActivity = millis();
+                }
+            }
+            _inHandle = false;
+            vTaskDelay(2 / portTICK_PERIOD_MS);
+        }
+    }
+
+    bool WiFiServices::busy() { return _lastActivity && (millis() - _lastActivity) < activityHoldMs; }
+
     bool WiFiServices::begin() {
         bool no_error = true;
 
@@ -33,6 +60,17 @@ namespace WebUI {
             return false;
         }
 
+        if (!servicesTaskHandle) {
+            xTaskCreatePinnedToCore(servicesTask,    // task
+                                    "wifiServices",  // name for task
+                                    8192,            // size of task stack
+                                    NULL,            // parameters
+                                    1,               // priority
+                                    &servicesTaskHandle,
+                                    SUPPORT_TASK_CORE  // core
+            );
+        }
+
         String h = wifi_hostname->get();
 
         ArduinoOTA
@@ -91,9 +129,20 @@ namespace WebUI {
 
         //be sure we are not is mixed mode in setup
         WiFi.scanNetworks(true);
+        _running = true;
         return no_error;
     }
     void WiFiServices::end() {
+        // Let the task finish its pass before the servers go away, unless
+        // this is called from the task itself, or from a web command that the
+        // task is waiting on.
+        _running = false;
+        if (xTaskGetCurrentTaskHandle() != servicesTaskHandle && !Web_Server::runningCommand()) {
+            while (_inHandle) {
+                vTaskDelay(1);
+            }
+        }
+
         notificationsservice.end();
         telnet_server.end();
         web_server.end();
@@ -118,7 +167,6 @@ namespace WebUI {
         }
         ArduinoOTA.handle();
         web_server.handle();
-        telnet_server.handle();
     }
 }
 #endif
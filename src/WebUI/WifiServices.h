@@ -5,7 +5,12 @@
 
 #include "../Config.h"  // ENABLE_*
 
+#include <cstdint>
+
 namespace WebUI {
+    // The web server, websocket server and OTA are serviced by a task of
+    // their own, so slow HTTP handlers do not hold up G-code input.  Work
+    // that must run on the main loop is handed over by Web_Server.
     class WiFiServices {
     public:
         WiFiServices();
@@ -14,7 +19,17 @@ namespace WebUI {
         static void end();
         static void handle();
 
+        // True while an HTTP request or upload has been active recently
+        static bool busy();
+
         ~WiFiServices();
+
+    private:
+        static void servicesTask(void* pvParameters);
+
+        static volatile bool     _running;
+        static volatile bool     _inHandle;
+        static volatile uint32_t _lastActivity;
     };
 
     extern WiFiServices wifi_services;
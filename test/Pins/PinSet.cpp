@@ -0,0 +1,94 @@
+#include "../TestFramework.h"
+
+#include <src/Pin.h>
+#include <src/Pins/PinSet.h>
+
+#ifdef ESP32
+extern "C" int  __digitalRead(uint8_t pin);
+extern "C" void __digitalWrite(uint8_t pin, uint8_t val);
+
+struct GPIONative {
+    inline static void initialize() {}
+    inline static bool read(int pin) { return __digitalRead(pin) != LOW; }
+};
+#else
+#    include <SoftwareGPIO.h>
+
+struct GPIONative {
+    // Every output pin simply reads back what was written to it:
+    static void Loopback(SoftwarePin* pins, int pin, bool value) { pins[pin].handlePadChange(value); }
+
+    inline static void initialize() { SoftwareGPIO::instance().reset(Loopback, false); }
+    inline static bool read(int pin) { return SoftwareGPIO::instance().read(pin); }
+};
+#endif
+
+namespace Pins {
+    Test(PinSet, GPIOMasks) {
+        GPIONative::initialize();
+
+        Pin gpio26 = Pin::create("gpio.26");
+        Pin gpio27 = Pin::create("gpio.27:low");
+        Pin gpio32 = Pin::create("gpio.32");
+
+        PinSet set;
+        Assert(set.add(gpio26));
+        Assert(set.add(gpio27));
+        Assert(set.add(gpio32));
+
+        // Active high pins are set when on, active low pins are cleared
+        Assert(set.on().gpioSet[0] == (1u << 26));
+        Assert(set.on().gpioClear[0] == (1u << 27));
+        Assert(set.on().gpioSet[1] == (1u << 0));
+        Assert(set.on().gpioClear[1] == 0);
+
+        Assert(set.off().gpioSet[0] == (1u << 27));
+        Assert(set.off().gpioClear[0] == (1u << 26));
+        Assert(set.off().gpioSet[1] == 0);
+        Assert(set.off().gpioClear[1] == (1u << 0));
+
+        Assert(set.on().i2soSet == 0 && set.on().i2soClear == 0);
+    }
+
+    Test(PinSet, UndefinedPinsAreIgnored) {
+        Pin undef;
+
+        PinSet set;
+        Assert(set.add(undef));
+        Assert(set.on().empty());
+        Assert(set.off().empty());
+    }
+
+    Test(PinSet, MasksMatchPinWrites) {
+        GPIONative::initialize();
+
+        Pin gpio26 = Pin::create("gpio.26");
+        Pin gpio27 = Pin::create("gpio.27:low");
+
+        gpio26.setAttr(Pin::Attr::Output);
+        gpio27.setAttr(Pin::Attr::Output);
+
+        PinSet set;
+        set.add(gpio26);
+        set.add(gpio27);
+
+        for (int i = 0; i < 2; ++i) {
+            bool value = i == 0;
+
+            gpio26.write(value);
+            gpio27.write(value);
+            bool native26 = GPIONative::read(26);
+            bool native27 = GPIONative::read(27);
+
+            set.value(!value).write();
+            Assert(native26 != GPIONative::read(26));
+            Assert(native27 != GPIONative::read(27));
+
+            set.value(value).write();
+            Assert(native26 == GPIONative::read(26));
+            Assert(native27 == GPIONative::read(27));
+            Assert(value == gpio26.read());
+            Assert(value == gpio27.read());
+        }
+    }
+}
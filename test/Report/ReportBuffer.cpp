@@ -0,0 +1,150 @@
+#include "../TestFramework.h"
+
+#include <src/ReportBuffer.h>
+
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <new>
+
+#ifndef ESP32
+#    include <chrono>
+#    include <WString.h>
+
+// Allocation-counting hook: every heap allocation in the test process goes
+// through here, so a test can check that a piece of code does not allocate.
+static size_t allocationCount = 0;
+
+void* operator new(size_t size) {
+    ++allocationCount;
+    void* p = malloc(size ? size : 1);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+void operator delete(void* p) noexcept {
+    free(p);
+}
+void operator delete(void* p, size_t) noexcept {
+    free(p);
+}
+#endif
+
+namespace Report {
+    static void checkFixed(float v, int decimals) {
+        char expected[32];
+        char actual[32];
+        snprintf(expected, sizeof(expected), "%.*f", decimals, v);
+        format_fixed(actual, v, decimals);
+
+        // printf keeps the sign of values that round to zero; the report does not
+        const char* e = expected;
+        if (e[0] == '-' && strspn(e + 1, "0.") == strlen(e + 1)) {
+            ++e;
+        }
+        Assert(strcmp(e, actual) == 0, "format_fixed mismatch");
+    }
+
+    Test(ReportBuffer, FixedMatchesPrintf) {
+        const float values[] = { 0.0f, 1.0f, -1.0f, 0.0005f, 0.0004f, -0.0004f, 1.9996f, 12.345f, -123.4567f, 999.9995f, 1234.5f, 25000.125f };
+        for (auto v : values) {
+            for (int decimals = 0; decimals <= 4; decimals++) {
+                checkFixed(v, decimals);
+            }
+        }
+        for (int i = -200000; i <= 200000; i += 37) {
+            checkFixed(i / 1000.0f, 3);
+            checkFixed(i / 10000.0f, 4);
+        }
+    }
+
+    Test(ReportBuffer, Integers) {
+        char         buf[64];
+        ReportBuffer rpt(buf, sizeof(buf));
+        rpt << 0 << ',' << -42 << ',' << 4294967295u << ',' << (-2147483647 - 1);
+        Assert(strcmp(rpt.data(), "0,-42,4294967295,-2147483648") == 0);
+        Assert(!rpt.overflowed());
+    }
+
+    Test(ReportBuffer, Overflow) {
+        char         buf[8];
+        ReportBuffer rpt(buf, sizeof(buf));
+        rpt << "<Idle";
+        rpt << "|MPos:";
+        Assert(rpt.overflowed());
+        Assert(strcmp(rpt.data(), "<Idle") == 0);
+        Assert(rpt.length() == 5);
+    }
+
+#ifndef ESP32
+    static const float position[] = { 123.456f, -78.9f, 0.001f, 359.999f, -0.5f, 10000.0f };
+
+    static void formatReport(ReportBuffer& rpt) {
+        rpt << "<Run|MPos:";
+        for (int i = 0; i < 6; i++) {
+            rpt.fixed(position[i], 3);
+            if (i < 5) {
+                rpt << ',';
+            }
+        }
+        rpt << "|FS:" << 1500.0f << "," << 12000u << "|Pn:XZ|Ov:" << 100 << "," << 100 << "," << 100 << ">\n";
+    }
+
+    Test(ReportBuffer, NoAllocations) {
+        char         buf[512];
+        ReportBuffer rpt(buf, sizeof(buf));
+
+        auto before = allocationCount;
+        for (int i = 0; i < 100; i++) {
+            rpt.clear();
+            formatReport(rpt);
+        }
+        Assert(allocationCount == before, "ReportBuffer allocated memory");
+        Assert(strncmp(rpt.data(), "<Run|MPos:123.456,-78.900,0.001,359.999,-0.500,10000.000|FS:1500.000,12000", 74) == 0);
+    }
+
+    Test(ReportBuffer, Benchmark) {
+        const int iterations = 100000;
+        using clock          = std::chrono::steady_clock;
+
+        char         buf[512];
+        ReportBuffer rpt(buf, sizeof(buf));
+
+        auto   start  = clock::now();
+        size_t sink   = 0;
+        auto   allocs = allocationCount;
+        for (int i = 0; i < iterations; i++) {
+            rpt.clear();
+            formatReport(rpt);
+            sink += rpt.length();
+        }
+        auto bufferNs     = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - start).count() / iterations;
+        auto bufferAllocs = allocationCount - allocs;
+
+        // The String-based formatting that report_realtime_status() used before
+        start  = clock::now();
+        allocs = allocationCount;
+        for (int i = 0; i < iterations; i++) {
+            String s = "<Run|MPos:";
+            for (int j = 0; j < 6; j++) {
+                s += String(position[j], 3);
+                if (j < 5) {
+                    s += ",";
+                }
+            }
+            s += "|FS:";
+            s += String(1500.0f, 3);
+            s += ",12000|Pn:XZ|Ov:100,100,100>\n";
+            sink += s.length();
+        }
+        auto stringNs     = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - start).count() / iterations;
+        auto stringAllocs = allocationCount - allocs;
+
+        Debug("ReportBuffer: %d ns/report, %d allocations/report", int(bufferNs), int(bufferAllocs / iterations));
+        Debug("String:       %d ns/report, %d allocations/report", int(stringNs), int(stringAllocs / iterations));
+        Assert(sink > 0);
+        Assert(bufferAllocs == 0);
+    }
+#endif
+}
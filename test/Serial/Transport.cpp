@@ -0,0 +1,157 @@
+#include "../TestFramework.h"
+
+#include <src/Transport.h>
+
+#include <cstring>
+
+namespace {
+    // A transport that only implements the byte-wise read
+    class StringTransport : public Transport {
+        const char* _data;
+
+    public:
+        StringTransport(const char* data) : _data(data) {}
+
+        int    available() override { return strlen(_data); }
+        int    read() override { return *_data ? uint8_t(*_data++) : -1; }
+        int    peek() override { return *_data ? uint8_t(*_data) : -1; }
+        size_t write(uint8_t c) override { return 1; }
+        void   flush() override {}
+    };
+
+    Test(Transport, DefaultBulkRead) {
+        StringTransport source("G0 X1\nG0 X2\n");
+        Transport&      transport = source;  // As pollClients() sees it
+        uint8_t         buffer[8];
+
+        Assert(transport.read(buffer, sizeof(buffer)) == 8);
+        Assert(memcmp(buffer, "G0 X1\nG0", 8) == 0);
+        Assert(transport.read(buffer, sizeof(buffer)) == 4);
+        Assert(memcmp(buffer, " X2\n", 4) == 0);
+        Assert(transport.read(buffer, sizeof(buffer)) == 0, "Bulk read must not wait for more data");
+    }
+}
+
+#if !defined ESP32 && !defined _WIN32
+#    include <chrono>
+#    include <thread>
+#    include <fcntl.h>
+#    include <sys/ioctl.h>
+#    include <unistd.h>
+
+namespace {
+    // Host loopback transport.  What is written to the pipe comes back out
+    // of the transport, so a sender thread can stand in for a G-code
+    // sender on the other end of a serial or network connection.
+    class PipeTransport : public Transport {
+        int _in;
+        int _out;
+
+    public:
+        PipeTransport() {
+            int fds[2];
+            Assert(pipe(fds) == 0);
+            _in  = fds[0];
+            _out = fds[1];
+            fcntl(_in, F_SETFL, fcntl(_in, F_GETFL) | O_NONBLOCK);
+        }
+        ~PipeTransport() {
+            close(_in);
+            close(_out);
+        }
+
+        int available() override {
+            int n = 0;
+            ioctl(_in, FIONREAD, &n);
+            return n;
+        }
+        int read() override {
+            uint8_t c;
+            return ::read(_in, &c, 1) == 1 ? c : -1;
+        }
+        size_t read(uint8_t* buffer, size_t length) override {
+            auto n = ::read(_in, buffer, length);
+            return n > 0 ? n : 0;
+        }
+        int    peek() override { return -1; }
+        size_t write(uint8_t c) override { return write(&c, 1); }
+        size_t write(const uint8_t* buffer, size_t length) override {
+            size_t done = 0;
+            while (done < length) {
+                auto n = ::write(_out, buffer + done, length - done);
+                if (n <= 0) {
+                    break;
+                }
+                done += n;
+            }
+            return done;
+        }
+        void flush() override {}
+    };
+
+    // Assembles lines the way pollClients() does
+    struct LineCounter {
+        char   line[255];
+        size_t len   = 0;
+        size_t lines = 0;
+
+        void feed(int c) {
+            if (c == '\n') {
+                line[len] = '\0';
+                ++lines;
+                len = 0;
+            } else if (c != '\r' && len + 1 < sizeof(line)) {
+                line[len++] = c;
+            }
+        }
+    };
+
+    static const char*  benchLine  = "G1 X123.456 Y-78.901 Z0.500 F1500\n";
+    static const size_t benchLines = 50000;
+
+    static void sendLines(PipeTransport* transport) {
+        size_t len = strlen(benchLine);
+        for (size_t i = 0; i < benchLines; i++) {
+            transport->write(reinterpret_cast<const uint8_t*>(benchLine), len);
+        }
+    }
+
+    Test(Transport, LoopbackThroughput) {
+        using clock = std::chrono::steady_clock;
+
+        // Byte-wise, as pollClients() read every transport before
+        PipeTransport bytewise;
+        LineCounter   counter;
+        auto          start  = clock::now();
+        std::thread   sender = std::thread(sendLines, &bytewise);
+        while (counter.lines < benchLines) {
+            int c = bytewise.read();
+            if (c >= 0) {
+                counter.feed(c);
+            }
+        }
+        sender.join();
+        auto byteUs = std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - start).count();
+        Assert(strncmp(counter.line, benchLine, strlen(benchLine) - 1) == 0 && counter.len == 0);
+
+        // Bulk, through a read-ahead buffer the size of InputClient's
+        PipeTransport bulk;
+        LineCounter   bulkCounter;
+        uint8_t       rx[64];
+        start  = clock::now();
+        sender = std::thread(sendLines, &bulk);
+        while (bulkCounter.lines < benchLines) {
+            size_t n = bulk.read(rx, sizeof(rx));
+            for (size_t i = 0; i < n; i++) {
+                bulkCounter.feed(rx[i]);
+            }
+        }
+        sender.join();
+        auto bulkUs = std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - start).count();
+        Assert(strncmp(bulkCounter.line, benchLine, strlen(benchLine) - 1) == 0 && bulkCounter.len == 0);
+
+        Debug("Byte-wise: %d lines/s", int(benchLines * 1000000.0 / (byteUs ? byteUs : 1)));
+        Debug("Bulk:      %d lines/s", int(benchLines * 1000000.0 / (bulkUs ? bulkUs : 1)));
+    }
+}
+#endif
@@ -0,0 +1,269 @@
+#include "../TestFramework.h"
+
+#include <src/Modbus.h>
+
+#include <cstdlib>
+#include <cstring>
+
+namespace Spindles {
+    // The bit-by-bit CRC that VFD::ModRTU_CRC() computed before
+    static uint16_t bitwiseCrc(const uint8_t* buf, size_t len) {
+        uint16_t crc = 0xFFFF;
+        for (size_t pos = 0; pos < len; pos++) {
+            crc ^= uint16_t(buf[pos]);
+            for (int i = 8; i != 0; i--) {
+                if ((crc & 0x0001) != 0) {
+                    crc >>= 1;
+                    crc ^= 0xA001;
+                } else {
+                    crc >>= 1;
+                }
+            }
+        }
+        return crc;
+    }
+
+    Test(Modbus, CrcKnownFrame) {
+        // Read 10 holding registers from device 1
+        uint8_t frame[8] = { 0x01, 0x03, 0x00, 0x00, 0x00, 0x0A };
+        Assert(Modbus::appendCrc(frame, 6) == 8);
+        Assert(frame[6] == 0xC5 && frame[7] == 0xCD);
+    }
+
+    Test(Modbus, CrcMatchesBitwise) {
+        uint8_t buf[Modbus::maxFrame];
+        srand(1);
+        for (int i = 0; i < 200; i++) {
+            size_t len = rand() % sizeof(buf);
+            for (size_t j = 0; j < len; j++) {
+                buf[j] = rand();
+            }
+            Assert(Modbus::crc16(buf, len) == bitwiseCrc(buf, len));
+        }
+    }
+
+    Test(Modbus, InterFrameTime) {
+        Assert(Modbus::interFrameUs(9600) == 4010);
+        Assert(Modbus::interFrameUs(19200) == 2005);
+        Assert(Modbus::interFrameUs(115200) == 1750);
+    }
+
+    Test(Modbus, ExpectedLength) {
+        uint8_t response[8] = { 0x01, 0x06, 0x20, 0x00, 0x00, 0x01 };
+        size_t  len         = Modbus::appendCrc(response, 6);
+
+        Modbus::FrameReceiver rx;
+        rx.begin(1, len, 1000000, 4010, 0);
+        Assert(rx.feed(response, 3, 100) == Modbus::FrameReceiver::State::Receiving);
+        Assert(rx.wanted() == len - 3);
+        Assert(rx.feed(response + 3, len - 3, 200) == Modbus::FrameReceiver::State::Complete);
+        Assert(rx.valid() && !rx.exception());
+
+        // Anything after the frame is not part of it
+        rx.begin(1, len, 1000000, 4010, 0);
+        uint8_t extra[10];
+        memcpy(extra, response, len);
+        extra[8] = extra[9] = 0x55;
+        rx.feed(extra, sizeof(extra), 100);
+        Assert(rx.valid() && rx.length() == len);
+    }
+
+    Test(Modbus, SilenceEndsFrame) {
+        uint8_t response[16] = { 0x01, 0x03, 0x04, 0x00, 0x10, 0x00, 0x20 };
+        size_t  len          = Modbus::appendCrc(response, 7);
+
+        Modbus::FrameReceiver rx;
+        rx.begin(1, 0, 1000000, 4010, 0);
+        rx.feed(response, 4, 100);
+        rx.feed(response + 4, len - 4, 2000);  // A gap shorter than 3.5 characters
+        Assert(rx.feed(nullptr, 0, 5000) == Modbus::FrameReceiver::State::Receiving);
+        Assert(rx.feed(nullptr, 0, 6100) == Modbus::FrameReceiver::State::Complete);
+        Assert(rx.valid() && rx.length() == len);
+    }
+
+    Test(Modbus, Exception) {
+        uint8_t response[8] = { 0x01, 0x83, 0x02 };
+        size_t  len         = Modbus::appendCrc(response, 3);
+
+        Modbus::FrameReceiver rx;
+        rx.begin(1, 9, 1000000, 4010, 0);
+        Assert(rx.feed(response, len, 100) == Modbus::FrameReceiver::State::Complete);
+        Assert(rx.exception() && rx.exceptionCode() == 2);
+    }
+
+    Test(Modbus, TimeoutAndBadFrames) {
+        Modbus::FrameReceiver rx;
+        rx.begin(1, 8, 1000000, 4010, 0);
+        Assert(rx.feed(nullptr, 0, 999999) == Modbus::FrameReceiver::State::Waiting);
+        Assert(rx.feed(nullptr, 0, 1000000) == Modbus::FrameReceiver::State::Timeout);
+
+        uint8_t response[8] = { 0x01, 0x06, 0x20, 0x00, 0x00, 0x01 };
+        size_t  len         = Modbus::appendCrc(response, 6);
+
+        // Corrupted CRC
+        response[7] ^= 1;
+        rx.begin(1, len, 1000000, 4010, 0);
+        rx.feed(response, len, 100);
+        Assert(rx.state() == Modbus::FrameReceiver::State::Complete && !rx.valid());
+        response[7] ^= 1;
+
+        // Another device
+        rx.begin(2, len, 1000000, 4010, 0);
+        rx.feed(response, len, 100);
+        Assert(!rx.valid());
+
+        // A leading zero, as some Huanyang VFDs send, is skipped
+        uint8_t padded[9] = { 0 };
+        memcpy(padded + 1, response, len);
+        rx.begin(1, len, 1000000, 4010, 0);
+        rx.feed(padded, len + 1, 100);
+        Assert(rx.valid());
+    }
+}
+
+#if !defined ESP32 && !defined _WIN32
+#    include <atomic>
+#    include <chrono>
+#    include <thread>
+#    include <fcntl.h>
+#    include <termios.h>
+#    include <unistd.h>
+
+namespace Spindles {
+    static uint32_t nowUs() {
+        using namespace std::chrono;
+        return uint32_t(duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count());
+    }
+
+    static const uint32_t gapUs = 4010;  // 9600 baud
+
+    // Reads one frame from fd with the receiver, polling the way the VFD
+    // task reads the UART
+    static bool receiveFrame(int fd, Modbus::FrameReceiver& rx, uint8_t id, size_t expected, uint32_t timeoutUs) {
+        rx.begin(id, expected, timeoutUs, gapUs, nowUs());
+        while (rx.receiving()) {
+            uint8_t chunk[16];
+            auto    n = read(fd, chunk, rx.wanted() < sizeof(chunk) ? rx.wanted() : sizeof(chunk));
+            rx.feed(chunk, n > 0 ? n : 0, nowUs());
+            if (n <= 0) {
+                usleep(200);
+            }
+        }
+        return rx.valid();
+    }
+
+    // A VFD on the other end of a pty.  It keeps 16 holding registers,
+    // answers function 3 (read holding registers) and 6 (write single
+    // register), and sends an exception for anything else.  Responses
+    // are written in two pieces with a pause shorter than the inter-frame
+    // time, as a slow RS485 adapter would deliver them.
+    struct SimulatedVFD {
+        static const uint8_t id = 1;
+
+        int               fd;
+        uint16_t          registers[16] = { 0 };
+        std::atomic<bool> running { true };
+        std::thread       thread;
+
+        SimulatedVFD(int fd) : fd(fd), thread(&SimulatedVFD::run, this) {}
+        ~SimulatedVFD() {
+            running = false;
+            thread.join();
+        }
+
+        void respond(uint8_t* frame, size_t len) {
+            len = Modbus::appendCrc(frame, len);
+            write(fd, frame, 3);
+            usleep(gapUs / 4);
+            write(fd, frame + 3, len - 3);
+        }
+
+        void run() {
+            Modbus::FrameReceiver rx;
+            while (running) {
+                if (!receiveFrame(fd, rx, id, 0, 100000)) {
+                    continue;
+                }
+                const uint8_t* req = rx.data();
+                uint8_t        resp[Modbus::maxFrame];
+                uint16_t       reg   = (req[2] << 8) | req[3];
+                uint16_t       value = (req[4] << 8) | req[5];
+                resp[0]              = id;
+                resp[1]              = req[1];
+                if (req[1] == 0x03 && reg + value <= 16) {
+                    resp[2] = value * 2;
+                    for (int i = 0; i < value; i++) {
+                        resp[3 + 2 * i] = registers[reg + i] >> 8;
+                        resp[4 + 2 * i] = registers[reg + i] & 0xff;
+                    }
+                    respond(resp, 3 + value * 2);
+                } else if (req[1] == 0x06 && reg < 16) {
+                    registers[reg] = value;
+                    memcpy(resp + 2, req + 2, 4);
+                    respond(resp, 6);
+                } else {
+                    resp[1] |= 0x80;
+                    resp[2] = 0x01;  // Illegal function
+                    respond(resp, 3);
+                }
+            }
+        }
+    };
+
+    static int makeRaw(int fd) {
+        Assert(fd >= 0);
+        termios tio;
+        tcgetattr(fd, &tio);
+        cfmakeraw(&tio);
+        tcsetattr(fd, TCSANOW, &tio);
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        return fd;
+    }
+
+    // The master side of a transaction, as VFD::transact() does it
+    static bool transact(int fd, const uint8_t* request, size_t len, Modbus::FrameReceiver& rx, size_t expected) {
+        uint8_t frame[Modbus::maxFrame];
+        memcpy(frame, request, len);
+        len = Modbus::appendCrc(frame, len);
+        write(fd, frame, len);
+        return receiveFrame(fd, rx, SimulatedVFD::id, expected, 1000000) && !rx.exception();
+    }
+
+    Test(Modbus, SimulatedVFD) {
+        int master = makeRaw(posix_openpt(O_RDWR | O_NOCTTY));
+        Assert(grantpt(master) == 0 && unlockpt(master) == 0);
+        int slave = makeRaw(open(ptsname(master), O_RDWR | O_NOCTTY));
+
+        {
+            SimulatedVFD          vfd(master);
+            Modbus::FrameReceiver rx;
+
+            // Set the speed register, then read it back
+            const uint8_t setSpeed[] = { 0x01, 0x06, 0x00, 0x02, 0x2E, 0xE0 };
+            auto          start      = nowUs();
+            Assert(transact(slave, setSpeed, sizeof(setSpeed), rx, 8));
+            auto writeUs = nowUs() - start;
+            Assert(memcmp(rx.data(), setSpeed, 6) == 0);
+
+            const uint8_t getSpeed[] = { 0x01, 0x03, 0x00, 0x02, 0x00, 0x01 };
+            Assert(transact(slave, getSpeed, sizeof(getSpeed), rx, 7));
+            Assert(rx.data()[3] == 0x2E && rx.data()[4] == 0xE0);
+
+            // An unknown length response ends with the line going quiet
+            Assert(transact(slave, getSpeed, sizeof(getSpeed), rx, 0));
+            Assert(rx.length() == 7);
+
+            const uint8_t bad[] = { 0x01, 0x2B, 0x0E, 0x01, 0x00 };
+            Assert(!transact(slave, bad, sizeof(bad), rx, 8));
+            Assert(rx.exception() && rx.exceptionCode() == 1);
+
+            // With the length known the reply is taken as soon as it is
+            // complete, not after a timeout
+            Debug("Write single register round trip: %d us", int(writeUs));
+            Assert(writeUs < 100000);
+        }
+        close(slave);
+        close(master);
+    }
+}
+#endif
@@ -0,0 +1,148 @@
+#include "../TestFramework.h"
+
+#include <src/Spindles/SpeedTable.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <vector>
+
+namespace Spindles {
+    struct MapEntry {
+        SpindleSpeed speed;
+        float        percent;
+        uint32_t     offset;
+        uint32_t     scale;
+    };
+    using Map = std::vector<MapEntry>;
+
+    // What Spindle::setupSpeeds() computes for each entry
+    static void setup(Map& speeds, uint32_t max_dev_speed) {
+        size_t nsegments = speeds.size() - 1;
+        for (size_t i = 0; i < nsegments; i++) {
+            speeds[i].offset   = speeds[i].percent / 100.0 * max_dev_speed;
+            float deltaPercent = (speeds[i + 1].percent - speeds[i].percent) / 100.0f;
+            float deltaRPM     = speeds[i + 1].speed - speeds[i].speed;
+            float scale        = deltaRPM == 0.0f ? 0.0f : (deltaPercent / deltaRPM);
+            speeds[i].scale    = uint32_t(scale * max_dev_speed * 65536);
+        }
+        speeds[nsegments].offset = SpindleSpeed(speeds[nsegments].percent / 100.0f * float(max_dev_speed));
+        speeds[nsegments].scale  = 0;
+    }
+
+    // The search that Spindle::mapSpeed() does without the table
+    static uint32_t walk(const Map& speeds, SpindleSpeed speed) {
+        if (speed < speeds[0].speed) {
+            return speeds[0].offset;
+        }
+        if (speed == 0) {
+            return speeds[0].offset;
+        }
+        int num_segments = speeds.size() - 1;
+        int i;
+        for (i = 0; i < num_segments; i++) {
+            if (speed < speeds[i + 1].speed) {
+                break;
+            }
+        }
+        uint32_t dev_speed = speeds[i].offset;
+        if (i < num_segments) {
+            dev_speed += (((speed - speeds[i].speed) * speeds[i].scale) >> 16);
+        }
+        return dev_speed;
+    }
+
+    static bool matches(const Map& speeds, uint32_t max_dev_speed) {
+        SpeedTable table;
+        Assert(table.build(speeds));
+        SpindleSpeed last = speeds.back().speed;
+        for (SpindleSpeed speed = 0; speed <= last + 100; speed++) {
+            if (table.map(speed) != walk(speeds, speed)) {
+                Debug("Speed %u: table %u, search %u", speed, table.map(speed), walk(speeds, speed));
+                return false;
+            }
+        }
+        return true;
+    }
+
+    Test(SpeedTable, Linear) {
+        Map speeds = { { 0, 0.0f }, { 24000, 100.0f } };
+        setup(speeds, 1023);
+        Assert(matches(speeds, 1023));
+    }
+
+    Test(SpeedTable, Shelf) {
+        // As shelfSpeeds(6000, 24000) lays it out: off at 0, a step to the
+        // minimum, flat up to it, then linear
+        Map speeds = { { 0, 0.0f }, { 0, 25.0f }, { 6000, 25.0f }, { 24000, 100.0f } };
+        setup(speeds, 65535);
+        Assert(matches(speeds, 65535));
+        SpeedTable table;
+        table.build(speeds);
+        Assert(table.map(0) == 0);
+        Assert(table.map(1) == speeds[1].offset);
+    }
+
+    Test(SpeedTable, RandomMaps) {
+        srand(1);
+        for (int n = 0; n < 50; n++) {
+            // Entries closer together than a cell, and repeated speeds
+            Map          speeds;
+            SpindleSpeed speed = rand() % 3 ? 0 : rand() % 500;
+            size_t       count = 2 + rand() % (SpeedTable::maxEntries - 1);
+            for (size_t i = 0; i < count; i++) {
+                speeds.push_back({ speed, float(rand() % 1001) / 10.0f });
+                speed += rand() % 4 ? rand() % 3000 : rand() % 3;
+            }
+            setup(speeds, 1 << (rand() % 17));
+            Assert(matches(speeds, 0));
+        }
+    }
+
+    Test(SpeedTable, Unusable) {
+        SpeedTable table;
+        Map        speeds = { { 0, 0.0f } };
+        Assert(!table.build(speeds) && !table.ready());
+
+        speeds = { { 0, 0.0f }, { 10000, 50.0f }, { 5000, 100.0f } };
+        Assert(!table.build(speeds));
+
+        speeds.clear();
+        for (size_t i = 0; i <= SpeedTable::maxEntries; i++) {
+            speeds.push_back({ SpindleSpeed(i * 100), float(i) });
+        }
+        Assert(!table.build(speeds));
+    }
+
+    Test(SpeedTable, Benchmark) {
+        // A laser map with a dozen entries, looked up the way the stepper
+        // prepares segments
+        Map speeds;
+        for (int i = 0; i <= 12; i++) {
+            speeds.push_back({ SpindleSpeed(i * 1000), float(i * i) * 100.0f / 144.0f });
+        }
+        setup(speeds, 1023);
+        SpeedTable table;
+        Assert(table.build(speeds));
+
+        const int n   = 2000000;
+        uint32_t  sum = 0;
+
+        using namespace std::chrono;
+        auto start = steady_clock::now();
+        for (int i = 0; i < n; i++) {
+            sum += walk(speeds, (i * 7919) % 13000);
+        }
+        auto     walkNs  = duration_cast<nanoseconds>(steady_clock::now() - start).count();
+        uint32_t walkSum = sum;
+
+        sum   = 0;
+        start = steady_clock::now();
+        for (int i = 0; i < n; i++) {
+            sum += table.map((i * 7919) % 13000);
+        }
+        auto tableNs = duration_cast<nanoseconds>(steady_clock::now() - start).count();
+
+        Assert(sum == walkSum);
+        Debug("Speed map search %.1f ns, table %.1f ns per lookup", double(walkNs) / n, double(tableNs) / n);
+    }
+}
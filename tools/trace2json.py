@@ -0,0 +1,124 @@
+#!/usr/bin/env python3
+# Copyright (c) 2021 -  FluidNC contributors
+# Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+"""Convert a FluidNC trace dump into a Chrome trace / Perfetto JSON timeline.
+
+The input is either the binary file written by $Trace/Dump=<file> (fetch
+it with $Xmodem/Send=<file>) or a capture of the text printed by a plain
+$Trace/Dump, in which case the hex lines between the BeginData/EndData
+markers are used.  Open the output in chrome://tracing or ui.perfetto.dev.
+
+    trace2json.py trace.bin trace.json
+"""
+
+import json
+import re
+import struct
+import sys
+
+HEADER = struct.Struct("<4sHHII")
+RECORD = struct.Struct("<IIHHI")
+
+# Must match Trace::Event in src/Trace.h
+STATE_CHANGE, ALARM, PLANNER_PUSH, PLANNER_POP, SEGMENT_PREP, SEGMENT_START, SEGMENTS_EMPTY, SPINDLE, LIMIT = range(1, 10)
+
+STATES = ["Idle", "Alarm", "CheckMode", "Homing", "Cycle", "Hold", "Jog", "SafetyDoor", "Sleep", "ConfigAlarm"]
+ALARMS = ["None", "HardLimit", "SoftLimit", "AbortCycle", "ProbeFailInitial", "ProbeFailContact", "HomingFailReset",
+          "HomingFailDoor", "HomingFailPulloff", "HomingFailApproach", "SpindleControl", "ControlPin"]
+SPINDLE_STATES = ["Disable", "Cw", "Ccw", "Unknown"]
+
+PID = 1
+TID_STATE, TID_PLANNER, TID_STEPPER, TID_IO = 1, 2, 3, 4
+THREAD_NAMES = {TID_STATE: "State", TID_PLANNER: "Planner", TID_STEPPER: "Stepper", TID_IO: "Spindle and limits"}
+
+
+def name_of(names, value):
+    return names[value] if value < len(names) else str(value)
+
+
+def load(path):
+    with open(path, "rb") as f:
+        data = f.read()
+    if data[:4] == b"FNCT":
+        return data
+    # Text capture: the header and every record are one line of 32 hex digits
+    text = data.decode("ascii", errors="replace")
+    return b"".join(bytes.fromhex(line) for line in text.split() if re.fullmatch(r"[0-9a-f]{32}", line))
+
+
+def parse(data):
+    magic, version, record_size, count, cycles_per_us = HEADER.unpack_from(data, 0)
+    if magic != b"FNCT" or version != 1 or record_size != RECORD.size:
+        sys.exit("Not a FluidNC trace dump")
+    offset = HEADER.size
+    records = []
+    for _ in range(count):
+        records.append(RECORD.unpack_from(data, offset))
+        offset += RECORD.size
+    return cycles_per_us, records
+
+
+def timestamps(cycles_per_us, records):
+    """Unwraps the 32-bit cycle counter using millis(), returns microseconds."""
+    result = []
+    for cycles, millis, _, _, _ in records:
+        expected = millis * 1000 * cycles_per_us
+        wraps = round((expected - cycles) / 2**32)
+        result.append((cycles + wraps * 2**32) / cycles_per_us)
+    start = result[0] if result else 0
+    return [t - start for t in result]
+
+
+def convert(cycles_per_us, records):
+    events = [{"ph": "M", "pid": PID, "name": "process_name", "args": {"name": "FluidNC"}}]
+    for tid, name in THREAD_NAMES.items():
+        events.append({"ph": "M", "pid": PID, "tid": tid, "name": "thread_name", "args": {"name": name}})
+
+    times = timestamps(cycles_per_us, records)
+    state = None
+    state_start = 0
+
+    for ts, (_, _, event, a, b) in zip(times, records):
+        if event == STATE_CHANGE:
+            if state is not None:
+                events.append({"ph": "X", "pid": PID, "tid": TID_STATE, "name": state, "ts": state_start, "dur": ts - state_start})
+            state = name_of(STATES, a)
+            state_start = ts
+        elif event == ALARM:
+            events.append({"ph": "i", "s": "g", "pid": PID, "tid": TID_STATE, "name": "Alarm " + name_of(ALARMS, a), "ts": ts})
+        elif event in (PLANNER_PUSH, PLANNER_POP):
+            events.append({"ph": "C", "pid": PID, "name": "Planner blocks", "ts": ts, "args": {"blocks": a}})
+            if event == PLANNER_PUSH:
+                events.append({"ph": "i", "s": "t", "pid": PID, "tid": TID_PLANNER, "name": "Push", "ts": ts, "args": {"line": b}})
+        elif event == SEGMENT_PREP:
+            events.append({"ph": "i", "s": "t", "pid": PID, "tid": TID_STEPPER, "name": "Prep", "ts": ts, "args": {"steps": a, "block": b}})
+        elif event == SEGMENT_START:
+            events.append({"ph": "i", "s": "t", "pid": PID, "tid": TID_STEPPER, "name": "Segment", "ts": ts, "args": {"steps": a, "block": b}})
+        elif event == SEGMENTS_EMPTY:
+            events.append({"ph": "i", "s": "t", "pid": PID, "tid": TID_STEPPER, "name": "Segments empty", "ts": ts})
+        elif event == SPINDLE:
+            events.append({"ph": "C", "pid": PID, "name": "Spindle speed", "ts": ts, "args": {"speed": b}})
+            events.append({"ph": "i", "s": "t", "pid": PID, "tid": TID_IO, "name": "Spindle " + name_of(SPINDLE_STATES, a), "ts": ts})
+        elif event == LIMIT:
+            events.append({"ph": "i", "s": "t", "pid": PID, "tid": TID_IO, "name": "Limit " + ("on" if a else "off"), "ts": ts,
+                           "args": {"motors": "0x%08x" % b}})
+        else:
+            events.append({"ph": "i", "s": "t", "pid": PID, "tid": TID_IO, "name": "Event %d" % event, "ts": ts, "args": {"a": a, "b": b}})
+
+    if state is not None and times:
+        events.append({"ph": "X", "pid": PID, "tid": TID_STATE, "name": state, "ts": state_start, "dur": times[-1] - state_start})
+
+    return {"traceEvents": events, "displayTimeUnit": "ms"}
+
+
+def main():
+    if len(sys.argv) not in (2, 3):
+        sys.exit(__doc__)
+    cycles_per_us, records = parse(load(sys.argv[1]))
+    out = open(sys.argv[2], "w") if len(sys.argv) == 3 else sys.stdout
+    json.dump(convert(cycles_per_us, records), out, indent=1)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,120 @@
+#!/usr/bin/env python3
+# Copyright (c) 2021 -  FluidNC contributors
+# Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+"""Stream a G-code file to FluidNC over the websocket job channel.
+
+With --compare the file is also sent the way WebUI sends commands, one
+HTTP /command request per line with the replies arriving on the
+websocket, and the line rates of the two paths are printed.  Run it with
+the machine in a state where the file can execute, e.g. with $Motor/Disable
+or in check mode ($C), so that the planner rather than the motion sets
+the pace.
+
+    ws_stream.py [--port 80] [--session ID] [--compare] host file.nc
+
+Needs the websocket-client package.
+"""
+
+import argparse
+import sys
+import time
+import urllib.parse
+import urllib.request
+
+import websocket  # pip install websocket-client
+
+
+def read_lines(path):
+    lines = []
+    with open(path) as f:
+        for line in f:
+            line = line.split(";")[0].strip()
+            if line:
+                lines.append(line + "\n")
+    return lines
+
+
+def job_stream(ws, lines, session):
+    ws.send("JOB:START" + (":" + session if session else ""))
+    window = None
+    while window is None:
+        msg = ws.recv()
+        if isinstance(msg, str) and msg.startswith("JOB:WINDOW:"):
+            window = int(msg.split(":")[2])
+        elif isinstance(msg, str) and msg.startswith("JOB:ERROR"):
+            sys.exit(msg)
+
+    data = "".join(lines).encode()
+    frame = window // 4
+    sent = 0
+    consumed = 0
+    acked = 0
+    start = time.time()
+    while acked < len(lines):
+        while sent < len(data) and sent - consumed < window:
+            n = min(frame, len(data) - sent, window - (sent - consumed))
+            ws.send_binary(data[sent : sent + n])
+            sent += n
+        msg = ws.recv()
+        if not isinstance(msg, str):
+            continue
+        if msg.startswith("JOB:ACK:"):
+            _, _, lines_done, bytes_done = msg.split(":")
+            acked = int(lines_done)
+            consumed = int(bytes_done)
+        elif msg.startswith("JOB:ERR:"):
+            print(msg)
+        elif msg.startswith("JOB:ERROR"):
+            sys.exit(msg)
+    elapsed = time.time() - start
+    ws.send("JOB:STOP")
+    while True:
+        msg = ws.recv()
+        if isinstance(msg, str) and msg.startswith("JOB:DONE"):
+            print(msg)
+            break
+    return elapsed
+
+
+def command_stream(ws, host, port, lines, session):
+    headers = {"Cookie": "ESPSESSIONID=" + session} if session else {}
+    pending = b""
+    start = time.time()
+    for line in lines:
+        url = "http://%s:%d/command?plain=%s" % (host, port, urllib.parse.quote(line))
+        urllib.request.urlopen(urllib.request.Request(url, headers=headers)).read()
+        # Wait for the reply before sending the next line, as WebUI does
+        while True:
+            msg = ws.recv()
+            if isinstance(msg, bytes):
+                pending += msg
+                if b"ok\n" in pending or b"error:" in pending:
+                    pending = b""
+                    break
+    return time.time() - start
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--port", type=int, default=80, help="HTTP port, the websocket is on the next one")
+    parser.add_argument("--session", default="", help="ESPSESSIONID when authentication is enabled")
+    parser.add_argument("--compare", action="store_true", help="also time the /command path")
+    parser.add_argument("host")
+    parser.add_argument("file")
+    args = parser.parse_args()
+
+    lines = read_lines(args.file)
+    ws = websocket.create_connection("ws://%s:%d/" % (args.host, args.port + 1), subprotocols=["arduino"])
+
+    elapsed = job_stream(ws, lines, args.session)
+    print("job channel: %d lines in %.2f s, %.0f lines/s" % (len(lines), elapsed, len(lines) / elapsed))
+
+    if args.compare:
+        elapsed = command_stream(ws, args.host, args.port, lines, args.session)
+        print("/command:    %d lines in %.2f s, %.0f lines/s" % (len(lines), elapsed, len(lines) / elapsed))
+    ws.close()
+
+
+if __name__ == "__main__":
+    main()